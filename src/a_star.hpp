@@ -1,103 +1,245 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
-#include <queue>
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <cmath>
 #include <limits>
+#include <type_traits>
+#include <utility>
 #include <algorithm>
+#include "geometry.hpp"
 #include "map.hpp"
+#include "open_list.hpp"
+#include "profiler.hpp"
 
 namespace astar {
 
 inline int idx(int x, int y, int w) { return y * w + x; }
 
+// Work done by the last Planner::plan call.
+struct SearchStats {
+  long long expanded = 0;  // nodes closed
+  long long pushes = 0;    // open-list insertions
+  long long stalePops = 0; // popped entries already closed (lazy deletion)
+  size_t maxOpen = 0;      // largest open-list size
+};
+
 struct Node {
   int x, y; float f;
   bool operator<(const Node& other) const { return f > other.f; } // min-heap
 };
 
+// Cooperative cancellation shared by the planners: the search loops call
+// poll() once per expansion and it reads the flag every 256 calls, so a
+// cancelled search stops within a few microseconds at negligible cost.
+struct CancelFlag {
+  const std::atomic<bool>* flag = nullptr;
+  uint32_t n = 0;
+  bool poll() { return flag && (++n & 255u) == 0 && flag->load(std::memory_order_relaxed); }
+};
+
 inline float heuristic(int x0, int y0, int x1, int y1) {
   float dx = float(x0 - x1);
   float dy = float(y0 - y1);
   return std::sqrt(dx*dx + dy*dy);
 }
 
-inline std::vector<sf::Vector2i> plan(const GridMap& map, sf::Vector2i start, sf::Vector2i goal) {
-  std::vector<sf::Vector2i> empty;
-  if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return empty;
-  if (!map.isFree(start.x, start.y) || !map.isFree(goal.x, goal.y)) return empty;
-
-  const int w = map.w, h = map.h;
-  std::priority_queue<Node> open;
-  std::vector<uint8_t> closed(w * h, 0);
-  std::vector<float> g(w * h, std::numeric_limits<float>::infinity());
-  std::vector<int> came(w * h, -1);
-
-  int s = idx(start.x, start.y, w), t = idx(goal.x, goal.y, w);
-  g[s] = 0.f;
-  open.push({start.x, start.y, heuristic(start.x, start.y, goal.x, goal.y)});
-
-  const int dx[8] = {1,1,0,-1,-1,-1,0,1};
-  const int dy[8] = {0,1,1,1,0,-1,-1,-1};
-  const float cost[8] = {1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f)};
-
-  bool found = false;
-  while (!open.empty()) {
-    Node n = open.top(); open.pop();
-    int id = idx(n.x, n.y, w);
-    if (closed[id]) continue;
-    closed[id] = 1;
-    if (n.x == goal.x && n.y == goal.y) { found = true; break; }
-
-    for (int k = 0; k < 8; ++k) {
-      int nx = n.x + dx[k];
-      int ny = n.y + dy[k];
-      if (!map.inBounds(nx, ny) || !map.isFree(nx, ny)) continue;
-      int nid = idx(nx, ny, w);
-      float tentative = g[id] + cost[k];
-      if (tentative < g[nid]) {
-        g[nid] = tentative;
-        came[nid] = id;
-        float f = tentative + heuristic(nx, ny, goal.x, goal.y);
-        open.push({nx, ny, f});
+// Grids may optionally expose `float cellCost(x, y)` (>= 0); entering a cell
+// then costs the step length times 1 + cellCost, e.g. costmap::Costmap's
+// clearance penalty. The Euclidean heuristic stays admissible.
+template <class Grid, class = void>
+struct HasCellCost : std::false_type {};
+template <class Grid>
+struct HasCellCost<Grid, std::void_t<decltype(std::declval<const Grid&>().cellCost(0, 0))>> : std::true_type {};
+
+// Grids may also expose `float heuristic(x, y, gx, gy)`, an admissible and
+// consistent estimate of the cost from (x, y) to (gx, gy) that replaces the
+// Euclidean one, e.g. alt::View's landmark bound (landmarks.hpp).
+template <class Grid, class = void>
+struct HasHeuristic : std::false_type {};
+template <class Grid>
+struct HasHeuristic<Grid, std::void_t<decltype(std::declval<const Grid&>().heuristic(0, 0, 0, 0))>> : std::true_type {};
+
+template <class Grid>
+float estimate(const Grid& map, int x, int y, int gx, int gy) {
+  if constexpr (HasHeuristic<Grid>::value) return map.heuristic(x, y, gx, gy);
+  else return heuristic(x, y, gx, gy);
+}
+
+// Reusable search workspace. The per-cell arrays persist between queries and
+// are invalidated lazily with generation stamps, so a query costs
+// O(nodes expanded) instead of O(w*h); buffers are reallocated only when the
+// map size changes.
+//
+// plan() accepts any grid exposing w/h/inBounds/isFree/freeMask: GridMap,
+// the bit-packed BitGrid (bitgrid.hpp), whose padded rows answer freeMask
+// with three word reads instead of eight bounds-checked lookups, or the
+// inflated costmap::Costmap (costmap.hpp).
+//
+// `Open` is the open list (open_list.hpp): LazyHeap (the default binary heap
+// with duplicate entries), IndexedHeap4 (decrease-key, one entry per cell) or
+// BucketQueue (f-bucket ring for the bounded step costs). All three return
+// optimal paths; they differ in memory and heap traffic per expansion.
+template <class Open = LazyHeap>
+class BasicPlanner {
+public:
+  BasicPlanner() = default;
+  explicit BasicPlanner(Open open) : open_(std::move(open)) {}
+
+  template <class Grid>
+  std::vector<Vec2i> plan(const Grid& map, Vec2i start, Vec2i goal) {
+    std::vector<Vec2i> path;
+    plan(map, start, goal, path);
+    return path;
+  }
+
+  // While *flag is true, plan() abandons its search and returns false.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; }
+
+  const SearchStats& lastStats() const { return stats_; }
+
+  // Writes the path into `out` (cleared first); returns false if none exists.
+  template <class Grid>
+  bool plan(const Grid& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    PP_PROF_SCOPE("astar.plan");
+    bool found = search(map, start, goal, out);
+    PP_PROF_COUNT("astar.expanded", stats_.expanded);
+    PP_PROF_COUNT("astar.pushes", stats_.pushes);
+    PP_PROF_COUNT("astar.stale_pops", stats_.stalePops);
+    return found;
+  }
+
+private:
+  CancelFlag cancel_;
+  SearchStats stats_;
+  int w_ = 0, h_ = 0;
+  uint32_t gen_ = 0;
+  std::vector<uint32_t> seen_;   // generation in which g_/came_ were last written
+  std::vector<uint32_t> closed_; // generation in which the cell was expanded
+  std::vector<float> g_;
+  std::vector<int> came_;
+  Open open_;
+
+  template <class Grid>
+  bool search(const Grid& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    out.clear();
+    stats_ = {};
+    if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return false;
+    if (!map.isFree(start.x, start.y) || !map.isFree(goal.x, goal.y)) return false;
+
+    const int w = map.w;
+    prepare(map.w, map.h);
+
+    int s = idx(start.x, start.y, w), t = idx(goal.x, goal.y, w);
+    touch(s);
+    g_[s] = 0.f;
+    push(s, estimate(map, start.x, start.y, goal.x, goal.y));
+
+    const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    const float cost[8] = {1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f)};
+
+    bool found = false;
+    while (!open_.empty()) {
+      if (cancel_.poll()) return false;
+      int id = open_.pop();
+      if (closed_[id] == gen_) { ++stats_.stalePops; continue; }
+      closed_[id] = gen_;
+      ++stats_.expanded;
+      if (id == t) { found = true; break; }
+
+      const int cx = id % w, cy = id / w;
+      const unsigned freeDirs = map.freeMask(cx, cy);
+      for (int k = 0; k < 8; ++k) {
+        if (!((freeDirs >> k) & 1u)) continue;
+        int nx = cx + dx[k];
+        int ny = cy + dy[k];
+        int nid = idx(nx, ny, w);
+        touch(nid);
+        float step = cost[k];
+        if constexpr (HasCellCost<Grid>::value) step *= 1.f + map.cellCost(nx, ny);
+        float tentative = g_[id] + step;
+        if (tentative < g_[nid]) {
+          g_[nid] = tentative;
+          came_[nid] = id;
+          push(nid, tentative + estimate(map, nx, ny, goal.x, goal.y));
+        }
       }
     }
+
+    if (!found) return false;
+
+    // Reconstruct
+    int cur = t;
+    while (cur != -1) {
+      int cx = cur % w;
+      int cy = cur / w;
+      out.push_back({cx, cy});
+      if (cur == s) break;
+      cur = came_[cur];
+    }
+    std::reverse(out.begin(), out.end());
+    return true;
+  }
+
+  void prepare(int w, int h) {
+    if (w != w_ || h != h_) {
+      w_ = w; h_ = h;
+      seen_.assign(size_t(w) * h, 0);
+      closed_.assign(size_t(w) * h, 0);
+      g_.resize(size_t(w) * h);
+      came_.resize(size_t(w) * h);
+      open_.reset(size_t(w) * h);
+      gen_ = 0;
+    }
+    if (++gen_ == 0) { // stamp wrap-around: clear once every 2^32 queries
+      std::fill(seen_.begin(), seen_.end(), 0u);
+      std::fill(closed_.begin(), closed_.end(), 0u);
+      gen_ = 1;
+    }
+    open_.clear();
+  }
+
+  void touch(int id) {
+    if (seen_[id] == gen_) return;
+    seen_[id] = gen_;
+    g_[id] = std::numeric_limits<float>::infinity();
+    came_[id] = -1;
   }
 
-  if (!found) return empty;
-
-  // Reconstruct
-  std::vector<sf::Vector2i> path;
-  int cur = t;
-  while (cur != -1) {
-    int cx = cur % w;
-    int cy = cur / w;
-    path.push_back({cx, cy});
-    if (cur == s) break;
-    cur = came[cur];
+  void push(int id, float f) {
+    ++stats_.pushes;
+    open_.push(id, f);
+    stats_.maxOpen = std::max(stats_.maxOpen, open_.size());
   }
-  std::reverse(path.begin(), path.end());
-  return path;
+};
+
+using Planner = BasicPlanner<>;
+
+// One-shot convenience wrapper; callers planning repeatedly should keep a Planner.
+inline std::vector<Vec2i> plan(const GridMap& map, Vec2i start, Vec2i goal) {
+  Planner planner;
+  return planner.plan(map, start, goal);
 }
 
-inline std::vector<sf::Vector2f> toFloatCenter(const std::vector<sf::Vector2i>& p) {
-  std::vector<sf::Vector2f> out; out.reserve(p.size());
+inline std::vector<Vec2f> toFloatCenter(const std::vector<Vec2i>& p) {
+  std::vector<Vec2f> out; out.reserve(p.size());
   for (auto& v : p) out.push_back({v.x + 0.5f, v.y + 0.5f});
   return out;
 }
 
-inline std::vector<sf::Vector2f> chaikin(const std::vector<sf::Vector2f>& poly, int iterations = 1) {
+inline std::vector<Vec2f> chaikin(const std::vector<Vec2f>& poly, int iterations = 1) {
   if (poly.size() < 2) return poly;
-  std::vector<sf::Vector2f> cur = poly;
+  std::vector<Vec2f> cur = poly;
   for (int it = 0; it < iterations; ++it) {
-    std::vector<sf::Vector2f> next; next.reserve(cur.size() * 2);
+    std::vector<Vec2f> next; next.reserve(cur.size() * 2);
     next.push_back(cur.front());
     for (size_t i = 0; i + 1 < cur.size(); ++i) {
-      sf::Vector2f P = cur[i];
-      sf::Vector2f Q = cur[i + 1];
-      sf::Vector2f R = 0.75f * P + 0.25f * Q; // keep closer to original
-      sf::Vector2f S = 0.25f * P + 0.75f * Q;
+      Vec2f P = cur[i];
+      Vec2f Q = cur[i + 1];
+      Vec2f R = 0.75f * P + 0.25f * Q; // keep closer to original
+      Vec2f S = 0.25f * P + 0.75f * Q;
       next.push_back(R);
       next.push_back(S);
     }
@@ -107,10 +249,10 @@ inline std::vector<sf::Vector2f> chaikin(const std::vector<sf::Vector2f>& poly,
   return cur;
 }
 
-inline float pathLength(const std::vector<sf::Vector2f>& p) {
+inline float pathLength(const std::vector<Vec2f>& p) {
   float L = 0.f;
   for (size_t i = 1; i < p.size(); ++i) {
-    sf::Vector2f d = p[i] - p[i-1];
+    Vec2f d = p[i] - p[i-1];
     L += std::sqrt(d.x*d.x + d.y*d.y);
   }
   return L;
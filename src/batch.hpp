@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "a_star.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+#include "profiler.hpp"
+
+// Multi-threaded batch planning against one read-only GridMap snapshot.
+// Worker threads persist across batches and each owns its own planner, so
+// search buffers are allocated once per thread. Every batch is split into
+// one contiguous range per worker; a worker that drains its range steals
+// chunks from the others, which keeps cores busy when query costs vary.
+// Results are written by query index, so they come back in input order.
+namespace batch {
+
+struct Query {
+  Vec2i start, goal;
+};
+
+struct Result {
+  std::vector<Vec2i> path; // empty if no path
+  double ms = 0.0;         // planning time of this query
+};
+
+struct Stats {
+  int threads = 0;
+  size_t queries = 0;
+  double wallMs = 0.0;
+  double queriesPerSec = 0.0;
+  size_t stolen = 0; // queries executed by a worker other than their owner
+};
+
+template <class Planner = astar::Planner>
+class BatchPlanner {
+public:
+  explicit BatchPlanner(int threads = 0)
+      : planners_(size_t(threads > 0 ? threads : int(std::max(1u, std::thread::hardware_concurrency())))),
+        ranges_(planners_.size()) {
+    try {
+      for (size_t i = 0; i < planners_.size(); ++i) workers_.emplace_back([this, i] { workerLoop(int(i)); });
+    } catch (...) { // a joinable std::thread must not be destroyed
+      stopWorkers();
+      throw;
+    }
+  }
+
+  ~BatchPlanner() { stopWorkers(); }
+
+  BatchPlanner(const BatchPlanner&) = delete;
+  BatchPlanner& operator=(const BatchPlanner&) = delete;
+
+  int threads() const { return int(workers_.size()); }
+
+  // Plan every query against `map` (which must not change during the call).
+  // `results` is resized to queries.size(); results[i] answers queries[i].
+  Stats run(const GridMap& map, const std::vector<Query>& queries, std::vector<Result>& results) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto t0 = Clock::now();
+    results.resize(queries.size());
+    const size_t n = queries.size(), nw = workers_.size();
+    for (size_t i = 0; i < nw; ++i) {
+      ranges_[i].next.store(n * i / nw, std::memory_order_relaxed);
+      ranges_[i].end = n * (i + 1) / nw;
+    }
+    stolen_.store(0, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      map_ = &map;
+      queries_ = &queries;
+      results_ = &results;
+      pending_ = nw;
+      ++epoch_;
+    }
+    wake_.notify_all();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+    Stats st;
+    st.threads = int(nw);
+    st.queries = n;
+    st.wallMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    st.queriesPerSec = st.wallMs > 0.0 ? 1000.0 * double(n) / st.wallMs : 0.0;
+    st.stolen = stolen_.load(std::memory_order_relaxed);
+    return st;
+  }
+
+private:
+  static constexpr size_t kChunk = 4; // queries claimed per steal
+
+  struct alignas(64) Range {
+    std::atomic<size_t> next{0};
+    size_t end = 0;
+  };
+
+  std::vector<Planner> planners_;
+  std::vector<Range> ranges_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_, done_;
+  bool stop_ = false;
+  unsigned long long epoch_ = 0;
+  size_t pending_ = 0;
+  const GridMap* map_ = nullptr;
+  const std::vector<Query>* queries_ = nullptr;
+  std::vector<Result>* results_ = nullptr;
+  std::atomic<size_t> stolen_{0};
+
+  void stopWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : workers_) t.join();
+  }
+
+  // Claim up to `count` indices from range r; returns the first or `end`.
+  size_t claim(Range& r, size_t count, size_t& last) {
+    size_t i = r.next.fetch_add(count, std::memory_order_relaxed);
+    if (i >= r.end) return r.end;
+    last = std::min(r.end, i + count);
+    return i;
+  }
+
+  void solve(int w, size_t i) {
+    using Clock = std::chrono::high_resolution_clock;
+    const Query& q = (*queries_)[i];
+    Result& res = (*results_)[i];
+    auto t0 = Clock::now();
+    planners_[size_t(w)].plan(*map_, q.start, q.goal, res.path);
+    res.ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+  }
+
+  void workerLoop(int w) {
+    PP_PROF_THREAD("batch");
+    unsigned long long seen = 0;
+    const size_t nw = ranges_.size();
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || epoch_ != seen; });
+        if (stop_) return;
+        seen = epoch_;
+      }
+      // Own range first, one query at a time
+      Range& mine = ranges_[size_t(w)];
+      for (size_t last = 0, i; (i = claim(mine, 1, last)) < mine.end;) solve(w, i);
+      // Then steal chunks from the others
+      for (size_t k = 1; k < nw; ++k) {
+        Range& victim = ranges_[(size_t(w) + k) % nw];
+        for (size_t last = 0, i; (i = claim(victim, kChunk, last)) < victim.end;) {
+          stolen_.fetch_add(last - i, std::memory_order_relaxed);
+          for (; i < last; ++i) solve(w, i);
+        }
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) done_.notify_one();
+    }
+  }
+};
+
+} // namespace batch
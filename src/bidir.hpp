@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "a_star.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+#include "open_list.hpp"
+#include "profiler.hpp"
+
+// Bidirectional A* on the 8-connected grid: a forward search from the start
+// and a backward search from the goal over the reversed edges. Both use the
+// average potential p(v) = (h(v, goal) - h(v, start)) / 2 (negated going
+// back), so the keys g + p are consistent for both sides at once. Whenever a
+// side relaxes a cell the other side has reached, start -> cell -> goal is a
+// candidate path, and the cheapest one so far is kept as mu. The sum of the
+// two smallest keys is a lower bound on any path not found yet, so the search
+// stops as soon as it reaches mu and the candidate is optimal. Cells whose
+// plain A* f already reaches mu are not queued. Costs and moves match
+// astar::Planner (including the optional cellCost hook), so path costs are
+// identical.
+//
+// In parallel mode the two sides run on two threads. Each publishes its g
+// values in a shared array of (generation, g) words that the other side reads
+// when it relaxes a cell, and its smallest key, which only grows, so a stale
+// read just delays the stop. The thread is started per query, so the mode
+// pays off on long routes (tens of thousands of expansions), not short ones.
+namespace bidir {
+
+class Planner {
+public:
+  explicit Planner(bool parallel = false) : parallel_(parallel) {}
+
+  bool parallel() const { return parallel_; }
+  void setParallel(bool parallel) { parallel_ = parallel; }
+
+  // While *flag is true, plan() abandons its search and returns false.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_ = flag; }
+
+  // Cells expanded by the last plan() call (both sides).
+  long long lastExpanded() const { return expanded_; }
+
+  template <class Grid>
+  std::vector<Vec2i> plan(const Grid& map, Vec2i start, Vec2i goal) {
+    std::vector<Vec2i> path;
+    plan(map, start, goal, path);
+    return path;
+  }
+
+  // Writes the path into `out` (cleared first); returns false if none exists.
+  template <class Grid>
+  bool plan(const Grid& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    PP_PROF_SCOPE("bidir.plan");
+    bool found = search(map, start, goal, out);
+    PP_PROF_COUNT("bidir.expanded", expanded_);
+    return found;
+  }
+
+private:
+  // One search direction. Per-cell arrays are generation stamped like
+  // astar::Planner's; `shared` mirrors g for the other thread.
+  struct alignas(64) Side { // own cache lines: the two threads write their sides constantly
+    std::vector<uint32_t> seen, closed;
+    std::vector<float> g;
+    std::vector<int> came;
+    std::unique_ptr<std::atomic<uint64_t>[]> shared; // (gen << 32) | float bits of g
+    astar::IndexedHeap4 open;
+    Vec2i target, source; // the goal and the start going forward, swapped going back
+    std::atomic<float> top{0.f}; // parallel: smallest queued key, published for the other side
+    bool backward = false;
+    long long expanded = 0;
+  };
+
+  bool parallel_ = false;
+  const std::atomic<bool>* cancel_ = nullptr;
+  long long expanded_ = 0;
+  int w_ = 0, h_ = 0;
+  uint32_t gen_ = 0;
+  Side fwd_, bwd_;
+  std::atomic<float> mu_{0.f}; // cost of the best start -> goal candidate
+  int meet_ = -1;              // its meeting cell (guarded by meetMutex_)
+  std::mutex meetMutex_;
+
+  static constexpr float kInf = std::numeric_limits<float>::infinity();
+
+  template <class Grid>
+  bool search(const Grid& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    out.clear();
+    expanded_ = 0;
+    if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return false;
+    if (!map.isFree(start.x, start.y) || !map.isFree(goal.x, goal.y)) return false;
+    if (start.x == goal.x && start.y == goal.y) { out.push_back(start); return true; }
+
+    const int w = map.w;
+    prepare(map.w, map.h);
+    const int s = astar::idx(start.x, start.y, w), t = astar::idx(goal.x, goal.y, w);
+    mu_.store(kInf, std::memory_order_relaxed);
+    meet_ = -1;
+    fwd_.target = goal; fwd_.source = start; fwd_.backward = false;
+    bwd_.target = start; bwd_.source = goal; bwd_.backward = true;
+    seed(fwd_, s, start);
+    seed(bwd_, t, goal);
+
+    bool cancelled = false;
+    if (parallel_) {
+      std::atomic<bool> done{false}, stop{false};
+      auto run = [&](Side& me, const Side& other) {
+        astar::CancelFlag cancel{cancel_};
+        while (!me.open.empty() && !done.load(std::memory_order_relaxed)) {
+          if (cancel.poll()) { stop.store(true, std::memory_order_relaxed); break; }
+          const float top = me.open.topKey();
+          me.top.store(top, std::memory_order_relaxed);
+          if (top + other.top.load(std::memory_order_relaxed) >= mu_.load(std::memory_order_relaxed)) break;
+          step(map, me, other, true);
+        }
+        done.store(true, std::memory_order_relaxed);
+      };
+      std::thread back(run, std::ref(bwd_), std::cref(fwd_));
+      run(fwd_, bwd_);
+      back.join();
+      cancelled = stop.load(std::memory_order_relaxed);
+    } else {
+      astar::CancelFlag cancel{cancel_};
+      while (!fwd_.open.empty() && !bwd_.open.empty()) {
+        if (cancel.poll()) { cancelled = true; break; }
+        const float tf = fwd_.open.topKey(), tb = bwd_.open.topKey();
+        if (tf + tb >= mu_.load(std::memory_order_relaxed)) break;
+        if (tf <= tb) step(map, fwd_, bwd_, false);
+        else step(map, bwd_, fwd_, false);
+      }
+    }
+    expanded_ = fwd_.expanded + bwd_.expanded;
+    if (cancelled || meet_ < 0) return false;
+
+    // start -> meet from the forward tree, meet -> goal from the backward tree
+    for (int cur = meet_; cur != -1; cur = fwd_.came[cur]) out.push_back({cur % w, cur / w});
+    std::reverse(out.begin(), out.end());
+    for (int cur = bwd_.came[meet_]; cur != -1; cur = bwd_.came[cur]) out.push_back({cur % w, cur / w});
+    return true;
+  }
+
+  void seed(Side& side, int id, Vec2i at) {
+    side.expanded = 0;
+    touch(side, id);
+    side.g[id] = 0.f;
+    publish(side, id);
+    side.top.store(potential(side, at.x, at.y), std::memory_order_relaxed);
+    side.open.push(id, potential(side, at.x, at.y));
+  }
+
+  // Expand the best cell of `me`, offering meeting candidates against `other`.
+  template <class Grid>
+  void step(const Grid& map, Side& me, const Side& other, bool shared) {
+    static const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    static const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    static const float cost[8] = {1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f)};
+
+    const int id = me.open.pop();
+    if (me.closed[id] == gen_) return;
+    me.closed[id] = gen_;
+    ++me.expanded;
+
+    const int w = w_;
+    const int cx = id % w, cy = id / w;
+    // Backward edges run neighbour -> cell, so they pay the cell's own cost.
+    float backScale = 1.f;
+    if constexpr (astar::HasCellCost<Grid>::value)
+      if (me.backward) backScale = 1.f + map.cellCost(cx, cy);
+    const unsigned freeDirs = map.freeMask(cx, cy); // symmetric: a move only needs its destination free
+    for (int k = 0; k < 8; ++k) {
+      if (!((freeDirs >> k) & 1u)) continue;
+      const int nx = cx + dx[k], ny = cy + dy[k];
+      const int nid = astar::idx(nx, ny, w);
+      touch(me, nid);
+      float c = cost[k] * backScale;
+      if constexpr (astar::HasCellCost<Grid>::value)
+        if (!me.backward) c *= 1.f + map.cellCost(nx, ny);
+      const float tentative = me.g[id] + c;
+      if (!(tentative < me.g[nid])) continue;
+      me.g[nid] = tentative;
+      me.came[nid] = id;
+      if (shared) publish(me, nid);
+      const float through = tentative + otherG(other, nid, shared);
+      if (through < mu_.load(std::memory_order_relaxed)) offer(through, nid);
+      const float toTarget = astar::heuristic(nx, ny, me.target.x, me.target.y);
+      if (tentative + toTarget < mu_.load(std::memory_order_relaxed))
+        me.open.push(nid, tentative + 0.5f * (toTarget - astar::heuristic(nx, ny, me.source.x, me.source.y)));
+    }
+  }
+
+  static float potential(const Side& side, int x, int y) {
+    return 0.5f * (astar::heuristic(x, y, side.target.x, side.target.y) - astar::heuristic(x, y, side.source.x, side.source.y));
+  }
+
+  void offer(float cost, int id) {
+    std::lock_guard<std::mutex> lock(meetMutex_);
+    if (cost < mu_.load(std::memory_order_relaxed)) {
+      mu_.store(cost, std::memory_order_relaxed);
+      meet_ = id;
+    }
+  }
+
+  // The owner stores and the reader loads sequentially consistent, so when
+  // both sides reach a cell at the same time at least one sees the other.
+  void publish(Side& side, int id) {
+    if (!side.shared) return;
+    uint32_t bits;
+    std::memcpy(&bits, &side.g[id], sizeof bits);
+    side.shared[id].store((uint64_t(gen_) << 32) | bits);
+  }
+
+  float otherG(const Side& other, int id, bool shared) const {
+    if (!shared) return other.seen[id] == gen_ ? other.g[id] : kInf;
+    const uint64_t v = other.shared[id].load();
+    if (uint32_t(v >> 32) != gen_) return kInf;
+    const uint32_t bits = uint32_t(v);
+    float g;
+    std::memcpy(&g, &bits, sizeof g);
+    return g;
+  }
+
+  void touch(Side& side, int id) {
+    if (side.seen[id] == gen_) return;
+    side.seen[id] = gen_;
+    side.g[id] = kInf;
+    side.came[id] = -1;
+  }
+
+  void prepare(int w, int h) {
+    const size_t n = size_t(w) * h;
+    bool wrap = false;
+    if (w != w_ || h != h_) {
+      w_ = w; h_ = h;
+      for (Side* side : {&fwd_, &bwd_}) {
+        side->seen.assign(n, 0);
+        side->closed.assign(n, 0);
+        side->g.resize(n);
+        side->came.resize(n);
+        side->shared.reset();
+        side->open.reset(n);
+      }
+      gen_ = 0;
+    }
+    if (++gen_ == 0) { // stamp wrap-around: clear once every 2^32 queries
+      wrap = true;
+      gen_ = 1;
+    }
+    for (Side* side : {&fwd_, &bwd_}) {
+      if (wrap) {
+        std::fill(side->seen.begin(), side->seen.end(), 0u);
+        std::fill(side->closed.begin(), side->closed.end(), 0u);
+        if (side->shared)
+          for (size_t i = 0; i < n; ++i) side->shared[i].store(0, std::memory_order_relaxed);
+      }
+      if (parallel_ && !side->shared) {
+        side->shared.reset(new std::atomic<uint64_t>[n]);
+        for (size_t i = 0; i < n; ++i) side->shared[i].store(0, std::memory_order_relaxed);
+      }
+      side->open.clear();
+    }
+  }
+};
+
+} // namespace bidir
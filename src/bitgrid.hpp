@@ -0,0 +1,180 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "map.hpp"
+
+namespace bits {
+
+inline int ctz64(uint64_t v) {
+#if defined(_MSC_VER)
+  unsigned long i; _BitScanForward64(&i, v); return int(i);
+#else
+  return __builtin_ctzll(v);
+#endif
+}
+
+inline int clz64(uint64_t v) {
+#if defined(_MSC_VER)
+  unsigned long i; _BitScanReverse64(&i, v); return 63 - int(i);
+#else
+  return __builtin_clzll(v);
+#endif
+}
+
+inline int popcount64(uint64_t v) {
+#if defined(_MSC_VER)
+  return int(__popcnt64(v));
+#else
+  return __builtin_popcountll(v);
+#endif
+}
+
+// Bits [lo, hi] of a word set, 0 <= lo <= hi < 64.
+inline uint64_t span(int lo, int hi) {
+  uint64_t top = (hi == 63) ? ~uint64_t(0) : ((uint64_t(1) << (hi + 1)) - 1);
+  return top & ~((uint64_t(1) << lo) - 1);
+}
+
+} // namespace bits
+
+// Packed occupancy: one bit per cell (1 = blocked), 8x smaller than
+// GridMap::occ. Every row carries a blocked border bit on each side and there
+// is a blocked row above and below, so lookups in [-1, w] x [-1, h] need no
+// bounds checks. Provides the same w/h/inBounds/isFree/freeMask surface as
+// GridMap, so astar::Planner can search it directly.
+struct BitGrid {
+  int w = 0;
+  int h = 0;
+  int stride = 0; // 64-bit words per padded row
+  std::vector<uint64_t> words;
+
+  void resize(int W, int H) {
+    w = W; h = H;
+    stride = (w + 2 + 63) / 64;
+    words.assign(size_t(h + 2) * stride, ~uint64_t(0));
+  }
+
+  void build(const GridMap& map) {
+    resize(map.w, map.h);
+    for (int y = 0; y < h; ++y) {
+      uint64_t* row = rowPtr(y);
+      const uint8_t* src = &map.occ[size_t(y) * w];
+      for (int x = 0; x < w; ++x) {
+        int b = x + 1;
+        if (!src[x]) row[b >> 6] &= ~(uint64_t(1) << (b & 63));
+      }
+    }
+  }
+
+  void set(int x, int y, bool blocked) {
+    if (!inBounds(x, y)) return;
+    int b = x + 1;
+    uint64_t& word = rowPtr(y)[b >> 6];
+    uint64_t m = uint64_t(1) << (b & 63);
+    word = blocked ? (word | m) : (word & ~m);
+  }
+
+  // Mirror one cell of `map` (e.g. after GridMap::toggle/setOcc).
+  void syncCell(const GridMap& map, int x, int y) {
+    if (map.inBounds(x, y)) set(x, y, map.occ[y * map.w + x] != 0);
+  }
+
+  bool inBounds(int x, int y) const { return x >= 0 && y >= 0 && x < w && y < h; }
+
+  // Valid on the padded range x in [-1, w], y in [-1, h]; the border is blocked.
+  bool blocked(int x, int y) const {
+    int b = x + 1;
+    return (rowPtr(y)[b >> 6] >> (b & 63)) & 1u;
+  }
+
+  bool isFree(int x, int y) const { return inBounds(x, y) && !blocked(x, y); }
+
+  // Free-neighbor mask of (x, y): bit k set when the neighbor in direction k
+  // of the planner's dx/dy tables ({1,0},{1,1},{0,1},{-1,1},{-1,0},{-1,-1},
+  // {0,-1},{1,-1}) is free. Three 3-bit row reads and one table lookup.
+  uint8_t freeMask(int x, int y) const {
+    uint32_t up = triple(y - 1, x), mid = triple(y, x), dn = triple(y + 1, x);
+    return kMaskTable[up | (mid << 3) | (dn << 6)];
+  }
+
+  // Any blocked cell in row y between x0 and x1 (inclusive)? Parts outside
+  // the grid count as blocked.
+  bool anyBlockedRow(int y, int x0, int x1) const {
+    if (y < 0 || y >= h || x0 < 0 || x1 >= w) return true;
+    if (x0 > x1) return false;
+    return countRow(y, x0, x1, true) != 0;
+  }
+
+  bool anyBlockedRect(int x0, int y0, int x1, int y1) const {
+    if (y0 < 0 || y1 >= h || x0 < 0 || x1 >= w) return true;
+    for (int y = y0; y <= y1; ++y)
+      if (anyBlockedRow(y, x0, x1)) return true;
+    return false;
+  }
+
+  // Number of blocked cells in the inclusive rectangle (clipped to the grid).
+  size_t countBlockedRect(int x0, int y0, int x1, int y1) const {
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= w) x1 = w - 1;
+    if (y1 >= h) y1 = h - 1;
+    size_t n = 0;
+    for (int y = y0; y <= y1 && x0 <= x1; ++y) n += countRow(y, x0, x1, false);
+    return n;
+  }
+
+  size_t countBlocked() const { return countBlockedRect(0, 0, w - 1, h - 1); }
+  size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+private:
+  static std::array<uint8_t, 512> makeMaskTable() {
+    // index bits: [0..2] row y-1, [3..5] row y, [6..8] row y+1; within a
+    // triple bit 0 = x-1, bit 1 = x, bit 2 = x+1 (1 = blocked)
+    const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    std::array<uint8_t, 512> t{};
+    for (int i = 0; i < 512; ++i) {
+      uint8_t m = 0;
+      for (int k = 0; k < 8; ++k) {
+        int bit = (dy[k] + 1) * 3 + (dx[k] + 1);
+        if (!((i >> bit) & 1)) m |= uint8_t(1u << k);
+      }
+      t[i] = m;
+    }
+    return t;
+  }
+  static inline const std::array<uint8_t, 512> kMaskTable = makeMaskTable();
+
+  uint64_t* rowPtr(int y) { return &words[size_t(y + 1) * stride]; }
+  const uint64_t* rowPtr(int y) const { return &words[size_t(y + 1) * stride]; }
+
+  // Blocked bits of cells x-1..x+1 in row y (bit 0 = x-1).
+  uint32_t triple(int y, int x) const {
+    const uint64_t* row = rowPtr(y);
+    int b = x; // padded index of x-1
+    int i = b >> 6, off = b & 63;
+    uint64_t v = row[i] >> off;
+    if (off > 61) v |= row[i + 1] << (64 - off);
+    return uint32_t(v & 7u);
+  }
+
+  size_t countRow(int y, int x0, int x1, bool stopAtFirst) const {
+    const uint64_t* row = rowPtr(y);
+    int b0 = x0 + 1, b1 = x1 + 1;
+    int i0 = b0 >> 6, i1 = b1 >> 6;
+    size_t n = 0;
+    for (int i = i0; i <= i1; ++i) {
+      int lo = (i == i0) ? (b0 & 63) : 0;
+      int hi = (i == i1) ? (b1 & 63) : 63;
+      n += size_t(bits::popcount64(row[i] & bits::span(lo, hi)));
+      if (stopAtFirst && n) return n;
+    }
+    return n;
+  }
+};
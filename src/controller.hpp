@@ -1,9 +1,10 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
+#include <algorithm>
 #include <cmath>
 #include <utility>
 #include <vector>
+#include "geometry.hpp"
 
 struct RobotState {
   float x{1.f}, y{1.f}, th{0.f};
@@ -15,55 +16,138 @@ inline float wrapAngle(float a) {
   return a;
 }
 
+// Smoothed path with cumulative arc length and a tracked progress point.
+// track() projects the robot onto the path but only searches a short arc
+// window around the previous projection, so per-tick cost does not grow with
+// the number of vertices; it falls back to a full scan after assign() or when
+// the robot is farther from the path than the window.
+class TrackedPath {
+public:
+  struct Projection {
+    size_t seg = 0;     // segment index (points[seg] -> points[seg + 1])
+    float t = 0.f;      // position along the segment in [0, 1]
+    float s = 0.f;      // arc length from the first point
+    float dist = 0.f;   // distance from the query point
+    float sign = 1.f;   // +1 left of the path tangent, -1 right
+  };
+
+  float behind = 0.5f; // arc length searched behind the last projection
+  float ahead = 2.0f;  // arc length searched ahead of it
+
+  TrackedPath() = default;
+  explicit TrackedPath(std::vector<Vec2f> pts) { assign(std::move(pts)); }
+
+  void assign(std::vector<Vec2f> pts) {
+    pts_ = std::move(pts);
+    arc_.assign(pts_.size(), 0.f);
+    for (size_t i = 1; i < pts_.size(); ++i) {
+      Vec2f d = pts_[i] - pts_[i - 1];
+      arc_[i] = arc_[i - 1] + std::sqrt(d.x*d.x + d.y*d.y);
+    }
+    tracked_ = false;
+    proj_ = {};
+  }
+
+  void clear() { assign({}); }
+
+  bool empty() const { return pts_.empty(); }
+  size_t size() const { return pts_.size(); }
+  const Vec2f& operator[](size_t i) const { return pts_[i]; }
+  const Vec2f& back() const { return pts_.back(); }
+  const std::vector<Vec2f>& points() const { return pts_; }
+
+  // Total arc length (cached; equals astar::pathLength(points())).
+  float length() const { return arc_.empty() ? 0.f : arc_.back(); }
+
+  // Last result of track().
+  const Projection& progress() const { return proj_; }
+
+  // Closest point on the path to `p`, searched near the previous projection.
+  const Projection& track(Vec2f p) {
+    proj_ = project(p, tracked_ ? &proj_ : nullptr);
+    tracked_ = pts_.size() >= 2;
+    return proj_;
+  }
+
+  // Point at arc length `s` (clamped to the path). Walks from the tracked
+  // segment when `s` lies ahead of it, which is the lookahead case.
+  Vec2f pointAt(float s) const { return pointAt(s, tracked_ ? &proj_ : nullptr); }
+
+  // Stateless forms of track()/pointAt() for callers that keep one
+  // Projection per follower on a shared path: `prev` (may be null) is that
+  // follower's previous projection.
+  Projection project(Vec2f p, const Projection* prev) const {
+    if (pts_.size() < 2) return {};
+    Projection best; best.dist = 1e9f;
+    if (prev) {
+      size_t lo = prev->seg;
+      while (lo > 0 && prev->s - arc_[lo] < behind) --lo;
+      for (size_t i = lo; i + 1 < pts_.size() && arc_[i] <= prev->s + ahead; ++i) consider(p, i, best);
+      if (best.dist <= ahead) return best;
+      best = {}; best.dist = 1e9f;
+    }
+    for (size_t i = 0; i + 1 < pts_.size(); ++i) consider(p, i, best);
+    return best;
+  }
+
+  Vec2f pointAt(float s, const Projection* from) const {
+    if (pts_.empty()) return {0.f, 0.f};
+    if (s <= 0.f) return pts_.front();
+    if (s >= length()) return pts_.back();
+    size_t i;
+    if (from && s >= arc_[from->seg]) {
+      i = from->seg;
+      while (arc_[i + 1] < s) ++i;
+    } else {
+      i = size_t(std::upper_bound(arc_.begin(), arc_.end(), s) - arc_.begin()) - 1;
+    }
+    float L = arc_[i + 1] - arc_[i];
+    float t = L > 1e-6f ? (s - arc_[i]) / L : 0.f;
+    return pts_[i] + (pts_[i + 1] - pts_[i]) * t;
+  }
+
+private:
+  std::vector<Vec2f> pts_;
+  std::vector<float> arc_; // arc_[i] = length of pts_[0..i]
+  Projection proj_;
+  bool tracked_ = false;
+
+  void consider(Vec2f p, size_t i, Projection& best) const {
+    Vec2f a = pts_[i], b = pts_[i+1];
+    Vec2f ab = b - a;
+    float ab2 = ab.x*ab.x + ab.y*ab.y;
+    if (ab2 < 1e-6f) return;
+    float t = ((p.x - a.x) * ab.x + (p.y - a.y) * ab.y) / ab2;
+    t = std::fmax(0.f, std::fmin(1.f, t));
+    Vec2f d = p - (a + t * ab);
+    float dlen = std::sqrt(d.x*d.x + d.y*d.y);
+    if (dlen >= best.dist) return;
+    // Sign via 2D cross product of path tangent and error vector
+    float cross = ab.x * d.y - ab.y * d.x;
+    best = {i, t, arc_[i] + t * (arc_[i+1] - arc_[i]), dlen, cross >= 0.f ? 1.f : -1.f};
+  }
+};
+
 struct PurePursuit {
   float lookahead{2.0f};
   float targetSpeed{2.0f};
 
-  sf::Vector2f targetPoint(const RobotState& s, const std::vector<sf::Vector2f>& path) const {
+  Vec2f targetPoint(const RobotState& s, TrackedPath& path) const {
     if (path.size() < 2) return {s.x, s.y};
-    // Find closest point on path and then the lookahead target
-    size_t bestSeg = 0; float bestT = 0.f; float bestDist2 = 1e9f;
-    sf::Vector2f pos{s.x, s.y};
-    for (size_t i = 0; i + 1 < path.size(); ++i) {
-      sf::Vector2f a = path[i], b = path[i+1];
-      sf::Vector2f ab = b - a;
-      float ab2 = ab.x*ab.x + ab.y*ab.y;
-      if (ab2 < 1e-6f) continue;
-      float t = ((pos.x - a.x) * ab.x + (pos.y - a.y) * ab.y) / ab2;
-      t = std::fmax(0.f, std::fmin(1.f, t));
-      sf::Vector2f proj = a + t * ab;
-      sf::Vector2f d = pos - proj;
-      float d2 = d.x*d.x + d.y*d.y;
-      if (d2 < bestDist2) { bestDist2 = d2; bestSeg = i; bestT = t; }
-    }
+    // Closest point on path, then the point one lookahead further along it
+    const TrackedPath::Projection& pr = path.track({s.x, s.y});
+    return path.pointAt(pr.s + std::fmax(0.1f, lookahead));
+  }
 
-    float Ld = std::fmax(0.1f, lookahead);
-    float remain = Ld;
-    sf::Vector2f a = path[bestSeg];
-    sf::Vector2f b = path[bestSeg + 1];
-    sf::Vector2f cur = a + (b - a) * bestT;
-    size_t i = bestSeg; float t = bestT;
-    while (remain > 0.f && i + 1 < path.size()) {
-      a = path[i]; b = path[i+1];
-      sf::Vector2f from = a + (b - a) * t;
-      sf::Vector2f seg = b - from;
-      float segLen = std::sqrt(seg.x*seg.x + seg.y*seg.y);
-      if (segLen >= remain) {
-        sf::Vector2f dir = (segLen > 1e-6f) ? (seg / segLen) : sf::Vector2f{0.f, 0.f};
-        cur = from + dir * remain;
-        break;
-      } else {
-        remain -= segLen;
-        ++i; t = 0.f;
-        cur = b;
-      }
-    }
-    return cur;
+  // One-shot variant for untracked paths (full O(N) projection).
+  Vec2f targetPoint(const RobotState& s, const std::vector<Vec2f>& path) const {
+    TrackedPath tp(path);
+    return targetPoint(s, tp);
   }
 
-  std::pair<float, float> control(const RobotState& s, const std::vector<sf::Vector2f>& path) const {
+  std::pair<float, float> control(const RobotState& s, TrackedPath& path) const {
     if (path.size() < 2) return {0.f, 0.f};
-    sf::Vector2f cur = targetPoint(s, path);
+    Vec2f cur = targetPoint(s, path);
 
     // Transform target into robot frame
     float dx = cur.x - s.x;
@@ -87,26 +171,16 @@ inline void integrate(RobotState& s, float v, float w, float dt) {
   s.th = wrapAngle(s.th + w * dt);
 }
 
-inline float lateralError(const RobotState& s, const std::vector<sf::Vector2f>& path) {
+inline float lateralError(const RobotState& s, TrackedPath& path) {
   if (path.size() < 2) return 0.f;
-  sf::Vector2f p{s.x, s.y};
-  float best = 1e9f; float sign = 1.f;
-  for (size_t i = 0; i + 1 < path.size(); ++i) {
-    sf::Vector2f a = path[i], b = path[i+1];
-    sf::Vector2f ab = b - a;
-    float ab2 = ab.x*ab.x + ab.y*ab.y;
-    if (ab2 < 1e-6f) continue;
-    float t = ((p.x - a.x) * ab.x + (p.y - a.y) * ab.y) / ab2;
-    t = std::fmax(0.f, std::fmin(1.f, t));
-    sf::Vector2f proj = a + t * ab;
-    sf::Vector2f d = p - proj;
-    float dlen = std::sqrt(d.x*d.x + d.y*d.y);
-    // Sign via 2D cross product of path tangent and error vector
-    float cross = ab.x * d.y - ab.y * d.x;
-    float sgn = (cross >= 0.f) ? 1.f : -1.f;
-    if (dlen < best) { best = dlen; sign = sgn; }
-  }
-  return sign * best;
+  const TrackedPath::Projection& pr = path.track({s.x, s.y});
+  return pr.sign * pr.dist;
+}
+
+// One-shot variant for untracked paths (full O(N) projection).
+inline float lateralError(const RobotState& s, const std::vector<Vec2f>& path) {
+  TrackedPath tp(path);
+  return lateralError(s, tp);
 }
 
 struct PIDLateralController {
@@ -115,7 +189,7 @@ struct PIDLateralController {
   float integral{0.0f};
   float prevErr{0.0f};
 
-  std::pair<float,float> control(const RobotState& s, const std::vector<sf::Vector2f>& path, float dt) {
+  std::pair<float,float> control(const RobotState& s, TrackedPath& path, float dt) {
     if (path.size() < 2) return {0.f, 0.f};
     float e = lateralError(s, path);
     integral += e * dt;
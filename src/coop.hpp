@@ -0,0 +1,356 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#include "a_star.hpp"
+#include "bitgrid.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+#include "open_list.hpp"
+#include "profiler.hpp"
+#include "static_astar.hpp"
+
+// Cooperative multi-agent planning: prioritized space-time A*. Agents are
+// planned one after another in priority order (their index); each search
+// runs over (cell, timestep) states, with 4-connected moves and waiting as
+// actions of one timestep, and avoids the cells and moves that the agents
+// before it reserved:
+//   vertex conflicts  two agents in one cell at the same timestep,
+//   swap conflicts    two agents trading cells in one timestep,
+//   parked agents     an agent that reached its goal stays there.
+// An agent may only finish where no earlier agent passes later. Reservations
+// live in one open-addressing hash table keyed on (timestep, cell), so their
+// memory grows with the total path length rather than with the map times
+// the horizon; two per-cell summary arrays add 8 bytes per cell. The
+// heuristic is the exact 4-connected distance to the agent's goal ignoring
+// other agents (astar::ReverseDistance, resumed on demand as in Silver's
+// Cooperative A*), so each agent gets the earliest arrival that the earlier
+// reservations allow.
+//
+// Prioritized planning is fast but incomplete: an agent fails if the
+// reservations before it leave no path within the horizon or the per-agent
+// expansion limit, and the remaining agents fail once the time budget is
+// spent. Failed agents reserve nothing and have empty paths.
+namespace coop {
+
+// Open-addressing hash map from 64-bit keys to 32-bit values with linear
+// probing, 12 bytes per slot and at most half full. No erase: clear() keeps
+// the capacity.
+class FlatMap {
+public:
+  static constexpr uint32_t kMissing = 0xffffffffu;
+
+  size_t size() const { return size_; }
+  size_t bytes() const { return keys_.size() * (sizeof(uint64_t) + sizeof(uint32_t)); }
+
+  void clear() {
+    std::fill(keys_.begin(), keys_.end(), kEmpty);
+    size_ = 0;
+  }
+
+  uint32_t get(uint64_t key) const {
+    if (keys_.empty()) return kMissing;
+    for (size_t i = slot(key);; i = (i + 1) & mask_) {
+      if (keys_[i] == key) return vals_[i];
+      if (keys_[i] == kEmpty) return kMissing;
+    }
+  }
+
+  // Inserts or overwrites; returns the value slot.
+  uint32_t& put(uint64_t key) {
+    if (2 * (size_ + 1) > keys_.size()) grow();
+    size_t i = slot(key);
+    for (; keys_[i] != kEmpty; i = (i + 1) & mask_)
+      if (keys_[i] == key) return vals_[i];
+    keys_[i] = key;
+    vals_[i] = kMissing;
+    ++size_;
+    return vals_[i];
+  }
+
+private:
+  static constexpr uint64_t kEmpty = ~0ull;
+
+  std::vector<uint64_t> keys_;
+  std::vector<uint32_t> vals_;
+  size_t size_ = 0, mask_ = 0;
+  int shift_ = 64;
+
+  size_t slot(uint64_t key) const { return size_t((key * 0x9E3779B97F4A7C15ull) >> shift_); } // Fibonacci hashing
+
+  void grow() {
+    std::vector<uint64_t> keys(std::max<size_t>(64, keys_.size() * 2), kEmpty);
+    std::vector<uint32_t> vals(keys.size());
+    keys.swap(keys_);
+    vals.swap(vals_);
+    mask_ = keys_.size() - 1;
+    shift_ = 64 - bits::ctz64(keys_.size());
+    for (size_t j = 0; j < keys.size(); ++j) {
+      if (keys[j] == kEmpty) continue;
+      size_t i = slot(keys[j]);
+      while (keys_[i] != kEmpty) i = (i + 1) & mask_;
+      keys_[i] = keys[j];
+      vals_[i] = vals[j];
+    }
+  }
+};
+
+// Which agent occupies each (cell, timestep), in a FlatMap keyed on both,
+// plus two small per-cell arrays: the timestep from which an agent parks
+// there and the last timestep anyone passes it. Most cells a search touches
+// are never reserved after its current timestep, and the per-cell arrays
+// answer those without hashing.
+class ReservationTable {
+public:
+  static constexpr uint32_t kNone = FlatMap::kMissing;
+  static constexpr uint32_t kParked = 0xfffffffeu; // at(): an agent parked there
+
+  // Forget all reservations, for a map of `cells` cells.
+  void clear(size_t cells) {
+    occupied_.clear();
+    parked_.assign(cells, kNone);
+    latest_.assign(cells, kNone);
+  }
+
+  size_t size() const { return occupied_.size(); }
+  size_t bytes() const { return occupied_.bytes() + (parked_.size() + latest_.size()) * sizeof(uint32_t); }
+
+  // Agent in `cell` at timestep t, kParked or kNone.
+  uint32_t at(int cell, int t) const {
+    if (uint32_t(t) >= parked_[size_t(cell)]) return kParked;
+    return moving(cell, t);
+  }
+
+  // Moving from `from` at t to `to` at t + 1 (to == from waits).
+  bool canMove(int from, int to, int t) const {
+    if (at(to, t + 1) != kNone) return false;
+    if (from == to) return true;
+    const uint32_t other = moving(to, t); // would it come the other way?
+    return other == kNone || moving(from, t + 1) != other;
+  }
+
+  // First timestep from which `cell` stays free; -1 if an agent parks there.
+  int freeFrom(int cell) const {
+    if (parked_[size_t(cell)] != kNone) return -1;
+    const uint32_t last = latest_[size_t(cell)];
+    return last == kNone ? 0 : int(last) + 1;
+  }
+
+  // Reserve path[t] for t = 0 .. size - 1, then its last cell for good.
+  void reserve(uint32_t agent, const std::vector<int>& path) {
+    for (size_t t = 0; t < path.size(); ++t) {
+      occupied_.put(key(path[t], int(t))) = agent;
+      uint32_t& last = latest_[size_t(path[t])];
+      if (last == kNone || last < uint32_t(t)) last = uint32_t(t);
+    }
+    if (!path.empty()) parked_[size_t(path.back())] = uint32_t(path.size() - 1);
+  }
+
+private:
+  FlatMap occupied_;               // (t, cell) -> agent
+  std::vector<uint32_t> parked_;   // timestep from which an agent stays, or kNone
+  std::vector<uint32_t> latest_;   // last reserved timestep, or kNone
+
+  static uint64_t key(int cell, int t) { return (uint64_t(uint32_t(t)) << 32) | uint32_t(cell); }
+
+  uint32_t moving(int cell, int t) const {
+    const uint32_t last = latest_[size_t(cell)];
+    if (last == kNone || uint32_t(t) > last) return kNone;
+    return occupied_.get(key(cell, t));
+  }
+};
+
+struct Agent { Vec2i start, goal; };
+
+struct Options {
+  int horizon = 0;              // last timestep a path may use; 0: 2 * (w + h)
+  long long maxExpanded = 0;    // per agent; 0: 256 * (w + h)
+  double budgetMs = 0.0;        // for the whole plan() call; 0: none
+};
+
+struct Stats {
+  int planned = 0, failed = 0;
+  long long expanded = 0;   // space-time states
+  long long settled = 0;    // cells settled by the distance heuristic
+  int makespan = 0;         // last arrival timestep
+  long long sumOfCosts = 0; // arrival timesteps summed over planned agents
+  size_t reservations = 0, tableBytes = 0;
+  double ms = 0.0;
+};
+
+struct Conflicts {
+  long long vertex = 0, swap = 0;
+  long long total() const { return vertex + swap; }
+};
+
+// Conflicts between timed paths (cell per timestep; agents stay on their
+// last cell afterwards), counted once per timestep they last. Empty paths
+// are ignored.
+inline Conflicts countConflicts(const std::vector<std::vector<Vec2i>>& paths, int w) {
+  Conflicts c;
+  size_t makespan = 0;
+  for (const auto& p : paths) makespan = std::max(makespan, p.size());
+  auto cellAt = [&](const std::vector<Vec2i>& p, size_t t) {
+    const Vec2i v = p[std::min(t, p.size() - 1)];
+    return astar::idx(v.x, v.y, w);
+  };
+  FlatMap now, next;
+  for (size_t t = 0; t < makespan; ++t) {
+    now.clear();
+    next.clear();
+    for (uint32_t a = 0; a < paths.size(); ++a) {
+      if (paths[a].empty()) continue;
+      uint32_t& slot = now.put(uint64_t(cellAt(paths[a], t)));
+      if (slot != FlatMap::kMissing) ++c.vertex;
+      else slot = a;
+      if (t + 1 < makespan) {
+        const int from = cellAt(paths[a], t), to = cellAt(paths[a], t + 1);
+        if (from != to) next.put((uint64_t(uint32_t(from)) << 32) | uint32_t(to)) = a;
+      }
+    }
+    if (t + 1 >= makespan) continue;
+    for (uint32_t a = 0; a < paths.size(); ++a) {
+      if (paths[a].empty()) continue;
+      const int from = cellAt(paths[a], t), to = cellAt(paths[a], t + 1);
+      if (from < to && next.get((uint64_t(uint32_t(to)) << 32) | uint32_t(from)) != FlatMap::kMissing) ++c.swap;
+    }
+  }
+  return c;
+}
+
+class Planner {
+public:
+  // While *flag is true, plan() abandons its search; unplanned agents fail.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; distance_.setCancelFlag(flag); }
+
+  const Stats& lastStats() const { return stats_; }
+  const ReservationTable& reservations() const { return table_; }
+
+  // Plan all agents in index order. paths[i] lists agent i's cell at every
+  // timestep from 0 to its arrival, or is empty if it failed. Returns the
+  // number of agents planned.
+  int plan(const GridMap& map, const std::vector<Agent>& agents, std::vector<std::vector<Vec2i>>& paths,
+           const Options& opts = {}) {
+    PP_PROF_SCOPE("coop.plan");
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto deadline = t0 + std::chrono::microseconds(static_cast<long long>(opts.budgetMs * 1000.0));
+    stats_ = {};
+    table_.clear(map.occ.size());
+    paths.assign(agents.size(), {});
+    w_ = map.w;
+    horizon_ = opts.horizon > 0 ? opts.horizon : 2 * (map.w + map.h);
+    maxExpanded_ = opts.maxExpanded > 0 ? opts.maxExpanded : 256LL * (map.w + map.h);
+    for (size_t i = 0; i < agents.size(); ++i) {
+      const bool late = opts.budgetMs > 0.0 && std::chrono::steady_clock::now() >= deadline;
+      if (late || cancel_.poll() || !search(map, agents[i], opts.budgetMs > 0.0 ? &deadline : nullptr)) {
+        ++stats_.failed;
+        continue;
+      }
+      table_.reserve(uint32_t(i), cells_);
+      paths[i].reserve(cells_.size());
+      for (int c : cells_) paths[i].push_back({c % w_, c / w_});
+      ++stats_.planned;
+      stats_.makespan = std::max(stats_.makespan, int(cells_.size()) - 1);
+      stats_.sumOfCosts += static_cast<long long>(cells_.size()) - 1;
+    }
+    stats_.reservations = table_.size();
+    stats_.tableBytes = table_.bytes();
+    stats_.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    PP_PROF_COUNT("coop.expanded", stats_.expanded);
+    return stats_.planned;
+  }
+
+private:
+  using TimePoint = std::chrono::steady_clock::time_point;
+  struct Node { int32_t cell, t; uint32_t parent; };
+
+  static constexpr int kDx[4] = {1, 0, -1, 0};
+  static constexpr int kDy[4] = {0, 1, 0, -1};
+  static constexpr int kDir[4] = {0, 2, 4, 6}; // freeMask bits
+
+  astar::CancelFlag cancel_;
+  astar::ReverseDistance<astar::Connect4, astar::Manhattan> distance_;
+  ReservationTable table_;
+  Stats stats_;
+  int w_ = 0, horizon_ = 0;
+  long long maxExpanded_ = 0;
+  std::vector<Node> nodes_;
+  FlatMap visited_; // (t, cell) -> node
+  astar::LazyHeap open_;
+  std::vector<int> cells_;
+
+  // Earliest-arrival path for one agent into cells_. Every action takes one
+  // timestep, so a state's g is its t and the first time it is generated is
+  // final: no decrease-key, only a visited set.
+  bool search(const GridMap& map, const Agent& a, const TimePoint* deadline) {
+    cells_.clear();
+    if (!map.inBounds(a.start.x, a.start.y) || !map.inBounds(a.goal.x, a.goal.y)) return false;
+    if (!map.isFree(a.start.x, a.start.y) || !map.isFree(a.goal.x, a.goal.y)) return false;
+    const int s = astar::idx(a.start.x, a.start.y, w_), goal = astar::idx(a.goal.x, a.goal.y, w_);
+    if (table_.at(s, 0) != ReservationTable::kNone) return false;
+
+    // The agent cannot finish before the last earlier agent leaves its goal,
+    // so f is at least that timestep as well.
+    const int arrival = table_.freeFrom(goal);
+    if (arrival < 0) return false;
+    distance_.start(map, a.goal, a.start);
+    const float h0 = distance_.distance(a.start.x, a.start.y);
+    if (h0 == std::numeric_limits<float>::infinity()) return false;
+    // Break f ties towards later timesteps: the offset stays below one step
+    const float tie = 0.5f / float(horizon_ + 1);
+
+    nodes_.clear();
+    visited_.clear();
+    open_.clear();
+    nodes_.push_back({s, 0, 0});
+    visited_.put(key(s, 0)) = 0;
+    open_.push(0, std::max(h0, float(arrival)));
+
+    long long expanded = 0;
+    uint32_t found = FlatMap::kMissing;
+    while (!open_.empty()) {
+      if (cancel_.poll()) break;
+      if (deadline && (expanded & 1023) == 0 && std::chrono::steady_clock::now() >= *deadline) break;
+      if (expanded >= maxExpanded_) break;
+      const uint32_t id = uint32_t(open_.pop());
+      const Node n = nodes_[id];
+      ++expanded;
+      if (n.cell == goal && n.t >= arrival) { found = id; break; }
+      if (n.t >= horizon_) continue;
+
+      const int cx = n.cell % w_, cy = n.cell / w_;
+      const unsigned freeDirs = map.freeMask(cx, cy);
+      for (int k = -1; k < 4; ++k) { // -1: wait
+        if (k >= 0 && !((freeDirs >> kDir[k]) & 1u)) continue;
+        const int nx = k < 0 ? cx : cx + kDx[k], ny = k < 0 ? cy : cy + kDy[k];
+        const int nc = astar::idx(nx, ny, w_);
+        if (!table_.canMove(n.cell, nc, n.t)) continue;
+        uint32_t& slot = visited_.put(key(nc, n.t + 1));
+        if (slot != FlatMap::kMissing) continue;
+        const float hn = distance_.distance(nx, ny);
+        if (hn == std::numeric_limits<float>::infinity()) continue;
+        slot = uint32_t(nodes_.size());
+        nodes_.push_back({nc, n.t + 1, id});
+        open_.push(int(slot), std::max(float(n.t + 1) + hn, float(arrival)) - tie * float(n.t + 1));
+      }
+    }
+    stats_.expanded += expanded;
+    stats_.settled += distance_.settled();
+    if (found == FlatMap::kMissing) return false;
+    for (uint32_t cur = found;; cur = nodes_[cur].parent) {
+      cells_.push_back(nodes_[cur].cell);
+      if (cur == 0) break;
+    }
+    std::reverse(cells_.begin(), cells_.end());
+    return true;
+  }
+
+  static uint64_t key(int cell, int t) { return (uint64_t(uint32_t(t)) << 32) | uint32_t(cell); }
+};
+
+} // namespace coop
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "geometry.hpp"
+#include "map.hpp"
+
+// Clearance layer over a GridMap. DistanceField holds the Euclidean distance
+// (in cells, centre to centre) from every cell to the nearest obstacle cell,
+// capped at maxDist, computed with the separable Felzenszwalb-Huttenlocher
+// transform in O(w*h). Because of the cap, a toggled cell only affects cells
+// within maxDist of it, so edits are repaired by re-running the transform on
+// a small window instead of the whole map.
+namespace costmap {
+
+class DistanceField {
+public:
+  explicit DistanceField(float maxDist = 16.f) : maxDist_(std::max(1.f, maxDist)) {}
+
+  float maxDist() const { return maxDist_; }
+  int width() const { return w_; }
+  int height() const { return h_; }
+
+  // Distance to the nearest obstacle (0 on obstacles, maxDist if none closer).
+  float at(int x, int y) const { return dist_[size_t(y) * size_t(w_) + size_t(x)]; }
+
+  void build(const GridMap& map) {
+    w_ = map.w; h_ = map.h;
+    occ_ = map.occ;
+    synced_ = map.version();
+    dist_.assign(occ_.size(), maxDist_);
+    transform(0, 0, w_, h_);
+  }
+
+  // Repair the field after cell (x, y) of `map` changed.
+  void cellChanged(const GridMap& map, int x, int y) {
+    if (!map.inBounds(x, y) || map.w != w_ || map.h != h_) return;
+    size_t i = size_t(y) * size_t(w_) + size_t(x);
+    uint8_t v = map.occ[i] ? 1 : 0;
+    if (occ_[i] == v) return;
+    occ_[i] = v;
+    const int r = reach();
+    transform(x - r, y - r, x + r + 1, y + r + 1);
+  }
+
+  // Diff against `map` and repair the changed cells; rebuilds on a size
+  // change or when so many cells changed that one full pass is cheaper.
+  void sync(const GridMap& map) {
+    if (map.w != w_ || map.h != h_) { build(map); return; }
+    const int r = reach();
+    const size_t limit = occ_.size() / size_t((2 * r + 1) * (2 * r + 1)) + 1;
+    std::vector<Vec2i> changed;
+    bool rebuild = false;
+    forEachChange(map, synced_, occ_, [&](int x, int y) {
+      changed.push_back({x, y});
+      return !(rebuild = changed.size() > limit);
+    });
+    if (rebuild) { build(map); return; }
+    for (const Vec2i& c : changed) cellChanged(map, c.x, c.y);
+    synced_ = map.version();
+  }
+
+private:
+  float maxDist_;
+  int w_ = 0, h_ = 0;
+  std::vector<uint8_t> occ_;  // occupancy the field was computed from
+  MapVersion synced_;         // map version occ_ was last synced to
+  std::vector<float> dist_;
+  // Scratch for transform()
+  std::vector<float> col_, f_, z_;
+  std::vector<int> v_;
+  std::vector<float> row_;
+
+  int reach() const { return int(std::ceil(maxDist_)); }
+
+  // Recompute dist_ on [x0, x1) x [y0, y1), reading obstacles from a window
+  // grown by reach() on every side (farther ones are beyond the cap).
+  void transform(int x0, int y0, int x1, int y1) {
+    x0 = std::max(0, x0); y0 = std::max(0, y0);
+    x1 = std::min(w_, x1); y1 = std::min(h_, y1);
+    if (x0 >= x1 || y0 >= y1) return;
+    const int r = reach();
+    const int ex0 = std::max(0, x0 - r), ey0 = std::max(0, y0 - r);
+    const int ex1 = std::min(w_, x1 + r), ey1 = std::min(h_, y1 + r);
+    const int ew = ex1 - ex0, eh = ey1 - ey0;
+    const float big = float(r + 1); // "no obstacle within reach" in one axis
+
+    // Pass 1: vertical distance to the nearest obstacle in the same column,
+    // swept down then up one row at a time (contiguous, vectorizes).
+    col_.assign(size_t(ew) * size_t(eh), big);
+    for (int y = 0; y < eh; ++y) {
+      const uint8_t* o = &occ_[size_t(ey0 + y) * size_t(w_) + size_t(ex0)];
+      float* c = &col_[size_t(y) * size_t(ew)];
+      const float* up = y ? c - ew : nullptr;
+      for (int x = 0; x < ew; ++x) {
+        float fromUp = up ? std::min(big, up[x] + 1.f) : big;
+        c[x] = o[x] ? 0.f : fromUp;
+      }
+    }
+    for (int y = eh - 2; y >= 0; --y) {
+      float* c = &col_[size_t(y) * size_t(ew)];
+      const float* dn = c + ew;
+      for (int x = 0; x < ew; ++x) c[x] = std::min(c[x], dn[x] + 1.f);
+    }
+
+    // Pass 2: per row, lower envelope of parabolas (x - q)^2 + col(q)^2
+    f_.resize(size_t(ew)); row_.resize(size_t(ew));
+    v_.resize(size_t(ew)); z_.resize(size_t(ew) + 1);
+    const float cap2 = maxDist_ * maxDist_;
+    for (int y = y0; y < y1; ++y) {
+      const float* c = &col_[size_t(y - ey0) * size_t(ew)];
+      for (int q = 0; q < ew; ++q) f_[size_t(q)] = c[q] * c[q];
+      envelope(ew);
+      float* out = &dist_[size_t(y) * size_t(w_)];
+      for (int x = x0; x < x1; ++x) {
+        float d2 = row_[size_t(x - ex0)];
+        out[x] = d2 >= cap2 ? maxDist_ : std::sqrt(d2);
+      }
+    }
+  }
+
+  // 1D squared distance transform of f_[0..n) into row_ (Felzenszwalb).
+  void envelope(int n) {
+    const float inf = std::numeric_limits<float>::infinity();
+    auto cross = [&](int q, int p) {
+      return ((f_[size_t(q)] + float(q) * float(q)) - (f_[size_t(p)] + float(p) * float(p))) / float(2 * (q - p));
+    };
+    int k = 0;
+    v_[0] = 0; z_[0] = -inf; z_[1] = inf;
+    for (int q = 1; q < n; ++q) {
+      float s = cross(q, v_[size_t(k)]);
+      while (s <= z_[size_t(k)]) { --k; s = cross(q, v_[size_t(k)]); }
+      ++k;
+      v_[size_t(k)] = q; z_[size_t(k)] = s; z_[size_t(k) + 1] = inf;
+    }
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+      while (z_[size_t(k) + 1] < float(q)) ++k;
+      float d = float(q - v_[size_t(k)]);
+      row_[size_t(q)] = d * d + f_[size_t(v_[size_t(k)])];
+    }
+  }
+};
+
+// Grid view for astar::Planner::plan that inflates obstacles by `radius`
+// cells and charges a clearance cost: stepping into a cell at distance d
+// costs the usual 1 or sqrt(2) times 1 + weight * (clearance - d) / (clearance
+// - radius) while d < clearance. Cells with d <= radius are blocked.
+class Costmap {
+public:
+  int w = 0, h = 0;
+
+  explicit Costmap(float radius = 0.f, float clearance = 0.f, float weight = 0.f)
+      : field_(std::max({1.f, radius + 1.f, clearance})),
+        radius_(std::max(0.f, radius)),
+        clearance_(std::max(radius_, clearance)),
+        weight_(std::max(0.f, weight)),
+        span_(std::max(1e-3f, clearance_ - radius_)) {}
+
+  void build(const GridMap& map) { field_.build(map); w = map.w; h = map.h; }
+  void sync(const GridMap& map) { field_.sync(map); w = map.w; h = map.h; }
+  void cellChanged(const GridMap& map, int x, int y) { field_.cellChanged(map, x, y); }
+
+  const DistanceField& field() const { return field_; }
+  float clearance(int x, int y) const { return field_.at(x, y); }
+
+  bool inBounds(int x, int y) const { return x >= 0 && y >= 0 && x < w && y < h; }
+  bool isFree(int x, int y) const { return inBounds(x, y) && field_.at(x, y) > radius_; }
+
+  uint8_t freeMask(int x, int y) const {
+    const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    uint8_t m = 0;
+    for (int k = 0; k < 8; ++k)
+      if (isFree(x + dx[k], y + dy[k])) m |= uint8_t(1u << k);
+    return m;
+  }
+
+  // Extra cost factor for entering (x, y); 0 at or beyond `clearance`.
+  float cellCost(int x, int y) const {
+    float d = field_.at(x, y);
+    return d >= clearance_ ? 0.f : weight_ * (clearance_ - d) / span_;
+  }
+
+private:
+  DistanceField field_;
+  float radius_, clearance_, weight_, span_;
+};
+
+} // namespace costmap
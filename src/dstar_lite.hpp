@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "a_star.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+
+// D* Lite (Koenig & Likhachev) incremental planner. The search runs backwards
+// from the goal and keeps g/rhs values between calls, so occupancy edits and
+// start moves only repair the affected part of the search tree instead of
+// replanning the whole grid. Same 8-connected model and costs as astar::plan.
+namespace dstar {
+
+class Planner {
+public:
+  // Bring the planner's occupancy snapshot in line with `map`, repairing only
+  // the cells that differ. A size change (or a wholesale rewrite) forces a
+  // full reset on the next plan().
+  void sync(const GridMap& map) {
+    if (!ready_ || map.w != w_ || map.h != h_) { ready_ = false; return; }
+    const size_t limit = occ_.size() / 8 + 64; // beyond this a fresh search is cheaper
+    size_t changed = 0;
+    forEachChange(map, synced_, occ_, [&](int x, int y) {
+      if (++changed > limit) { ready_ = false; return false; }
+      cellChanged(map, x, y);
+      return true;
+    });
+    synced_ = map.version();
+  }
+
+  // Notify the planner that cell (x, y) of `map` changed occupancy.
+  void cellChanged(const GridMap& map, int x, int y) {
+    if (!ready_ || !map.inBounds(x, y)) return;
+    int id = astar::idx(x, y, w_);
+    uint8_t v = map.occ[id] ? 1 : 0;
+    if (occ_[id] == v) return;
+    occ_[id] = v;
+    // Every edge touching the cell changed: fix it and all its neighbors
+    updateVertex(id);
+    for (int k = 0; k < 8; ++k) {
+      int nx = x + kDx[k], ny = y + kDy[k];
+      if (inBounds(nx, ny)) updateVertex(astar::idx(nx, ny, w_));
+    }
+  }
+
+  // While *flag is true, plan() stops repairing and returns false. The
+  // search tree stays consistent, so the next plan() resumes the repair.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; }
+
+  std::vector<Vec2i> plan(const GridMap& map, Vec2i start, Vec2i goal) {
+    std::vector<Vec2i> path;
+    plan(map, start, goal, path);
+    return path;
+  }
+
+  // Reuses the previous search tree unless the goal or map size changed.
+  bool plan(const GridMap& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    out.clear();
+    lastExpanded_ = 0;
+    if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return false;
+    if (!ready_ || map.w != w_ || map.h != h_ || goal != goal_) reset(map, start, goal);
+    moveStartTo(start);
+    if (occ_[astar::idx(start.x, start.y, w_)] || occ_[astar::idx(goal.x, goal.y, w_)]) return false;
+
+    if (!computeShortestPath()) return false;
+    const int s = astar::idx(start_.x, start_.y, w_);
+    const int t = astar::idx(goal_.x, goal_.y, w_);
+    if (!std::isfinite(g_[s])) return false;
+
+    // Greedy descent of c + g from the start yields a shortest path
+    int cur = s;
+    out.push_back(start_);
+    for (size_t guard = occ_.size(); cur != t && guard > 0; --guard) {
+      int cx = cur % w_, cy = cur / w_;
+      int best = -1; float bestCost = kInf;
+      for (int k = 0; k < 8; ++k) {
+        int nx = cx + kDx[k], ny = cy + kDy[k];
+        if (!inBounds(nx, ny)) continue;
+        int nid = astar::idx(nx, ny, w_);
+        float c = cost(cur, nid, k) + g_[nid];
+        if (c < bestCost) { bestCost = c; best = nid; }
+      }
+      if (best < 0) { out.clear(); return false; }
+      cur = best;
+      out.push_back({cur % w_, cur / w_});
+    }
+    if (cur != t) { out.clear(); return false; }
+    return true;
+  }
+
+  // Vertices expanded by the last plan() call (0 when nothing needed repair).
+  long long lastExpanded() const { return lastExpanded_; }
+
+private:
+  struct Key {
+    float k1, k2;
+    bool operator<(const Key& o) const { return k1 < o.k1 || (k1 == o.k1 && k2 < o.k2); }
+    bool operator==(const Key& o) const { return k1 == o.k1 && k2 == o.k2; }
+  };
+  struct Entry {
+    Key key; int id;
+    bool operator<(const Entry& o) const { return o.key < key; } // min-heap
+  };
+
+  static constexpr float kInf = std::numeric_limits<float>::infinity();
+  static constexpr int kDx[8] = {1,1,0,-1,-1,-1,0,1};
+  static constexpr int kDy[8] = {0,1,1,1,0,-1,-1,-1};
+
+  astar::CancelFlag cancel_;
+  bool ready_ = false;
+  int w_ = 0, h_ = 0;
+  Vec2i start_, goal_, last_;
+  float km_ = 0.f;
+  long long lastExpanded_ = 0;
+  std::vector<uint8_t> occ_;     // occupancy the search tree was built against
+  MapVersion synced_;            // map version occ_ was last synced to
+  std::vector<float> g_, rhs_;
+  std::vector<uint8_t> inOpen_;
+  std::vector<Key> openKey_;     // key of the live heap entry per cell
+  std::vector<Entry> open_;      // lazy-deletion heap
+
+  bool inBounds(int x, int y) const { return x >= 0 && y >= 0 && x < w_ && y < h_; }
+
+  float cost(int a, int b, int k) const {
+    if (occ_[a] || occ_[b]) return kInf;
+    return (k & 1) ? std::sqrt(2.f) : 1.f;
+  }
+
+  float h(int id) const {
+    return astar::heuristic(start_.x, start_.y, id % w_, id / w_);
+  }
+
+  Key calcKey(int id) const {
+    float m = std::min(g_[id], rhs_[id]);
+    return {m + h(id) + km_, m};
+  }
+
+  void reset(const GridMap& map, Vec2i start, Vec2i goal) {
+    w_ = map.w; h_ = map.h;
+    occ_.assign(map.occ.begin(), map.occ.end());
+    for (auto& o : occ_) o = o ? 1 : 0;
+    synced_ = map.version();
+    const size_t n = occ_.size();
+    g_.assign(n, kInf);
+    rhs_.assign(n, kInf);
+    inOpen_.assign(n, 0);
+    openKey_.resize(n);
+    open_.clear();
+    start_ = last_ = start;
+    goal_ = goal;
+    km_ = 0.f;
+    int t = astar::idx(goal.x, goal.y, w_);
+    rhs_[t] = 0.f;
+    insert(t, calcKey(t));
+    ready_ = true;
+  }
+
+  void moveStartTo(Vec2i s) {
+    if (s == start_) return;
+    start_ = s;
+    km_ += astar::heuristic(last_.x, last_.y, s.x, s.y);
+    last_ = s;
+  }
+
+  void insert(int id, Key k) {
+    inOpen_[id] = 1;
+    openKey_[id] = k;
+    open_.push_back({k, id});
+    std::push_heap(open_.begin(), open_.end());
+  }
+
+  void updateVertex(int id) {
+    const int t = astar::idx(goal_.x, goal_.y, w_);
+    if (id != t) {
+      int x = id % w_, y = id / w_;
+      float best = kInf;
+      if (!occ_[id]) {
+        for (int k = 0; k < 8; ++k) {
+          int nx = x + kDx[k], ny = y + kDy[k];
+          if (!inBounds(nx, ny)) continue;
+          int nid = astar::idx(nx, ny, w_);
+          best = std::min(best, cost(id, nid, k) + g_[nid]);
+        }
+      }
+      rhs_[id] = best;
+    }
+    if (g_[id] != rhs_[id]) insert(id, calcKey(id));
+    else inOpen_[id] = 0;
+  }
+
+  // Returns false if cancelled before the start became consistent.
+  bool computeShortestPath() {
+    const int s = astar::idx(start_.x, start_.y, w_);
+    while (!open_.empty()) {
+      if (cancel_.poll()) return false;
+      Entry top = open_.front();
+      if (!inOpen_[top.id] || !(openKey_[top.id] == top.key)) {
+        std::pop_heap(open_.begin(), open_.end()); open_.pop_back();
+        continue;
+      }
+      if (!(top.key < calcKey(s)) && rhs_[s] == g_[s]) break;
+      std::pop_heap(open_.begin(), open_.end()); open_.pop_back();
+      inOpen_[top.id] = 0;
+      ++lastExpanded_;
+
+      const int u = top.id;
+      Key knew = calcKey(u);
+      if (top.key < knew) { insert(u, knew); continue; }
+      if (g_[u] > rhs_[u]) g_[u] = rhs_[u];
+      else { g_[u] = kInf; updateVertex(u); }
+      int x = u % w_, y = u / w_;
+      for (int k = 0; k < 8; ++k) {
+        int nx = x + kDx[k], ny = y + kDy[k];
+        if (inBounds(nx, ny)) updateVertex(astar::idx(nx, ny, w_));
+      }
+    }
+    return true;
+  }
+};
+
+} // namespace dstar
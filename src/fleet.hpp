@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "controller.hpp"
+#include "geometry.hpp"
+
+// Headless multi-robot simulation. Robot poses, commands and Pure Pursuit
+// parameters are stored as structure-of-arrays, and each tick runs
+//   1. a scalar tracking pass (lookahead point on the robot's TrackedPath),
+//   2. a branch-free kernel that applies the pursuit law, the goal stop, the
+//      unicycle integration and the angle wrap to contiguous float arrays,
+//   3. a tracking pass at the new pose that accumulates the lateral error.
+// Paths are shared read-only between robots; each robot keeps its own
+// TrackedPath::Projection. Robots are independent, so blocks of kBlock
+// robots are stepped through the whole run on one thread (cache resident)
+// and the blocks are spread over a thread pool.
+namespace fleet {
+
+// sin and cos for a in [-pi, pi] without calls or branches, so loops using
+// it vectorize. Folds into [-pi/2, pi/2] and uses Taylor polynomials there
+// (error below 1e-7).
+inline void sinCos(float a, float& s, float& c) {
+  const float pi = 3.14159265f, hp = 1.57079633f;
+  const float fold = float(a > hp) - float(a < -hp);     // +1, -1 or 0
+  const float flip = 1.f - 2.f * fold * fold;             // -1 when folded
+  const float r = fold * pi + flip * a;                   // sin(r) = sin(a), cos(r) = flip * cos(a)
+  const float r2 = r * r;
+  s = r * (1.f + r2 * (-1.f / 6 + r2 * (1.f / 120 + r2 * (-1.f / 5040 + r2 * (1.f / 362880 + r2 * (-1.f / 39916800))))));
+  c = flip * (1.f + r2 * (-0.5f + r2 * (1.f / 24 + r2 * (-1.f / 720 + r2 * (1.f / 40320 + r2 * (-1.f / 3628800 + r2 * (1.f / 479001600)))))));
+}
+
+// wrapAngle() for inputs within one turn of [-pi, pi] (one step of a
+// bounded angular rate), without loops or branches.
+inline float wrapPi(float a) {
+  const float pi = 3.14159265f;
+  const float dn = a - 2.f * pi, up = a + 2.f * pi;
+  return a > pi ? dn : (a < -pi ? up : a);
+}
+
+struct Robots {
+  std::vector<float> x, y, th;          // pose
+  std::vector<float> lookahead, speed;  // Pure Pursuit parameters
+  std::vector<float> gx, gy;            // path end (stop within 0.5 cells)
+  std::vector<float> tx, ty;            // lookahead point of the current tick
+  std::vector<float> v, w;              // last command
+  std::vector<uint32_t> path;           // index into Simulator::paths()
+  std::vector<TrackedPath::Projection> proj;
+
+  size_t size() const { return x.size(); }
+};
+
+// Pure Pursuit + stop-at-goal + integrate for n robots. Matches
+// PurePursuit::control followed by integrate(), using sin(atan2(y, x)) =
+// y / hypot(x, y) so the loop needs no trig calls. Restrict-qualified
+// parameters let the compiler vectorize without runtime alias checks; GCC
+// also needs -fno-math-errno -fno-trapping-math (set for fleet_sim) to turn
+// the sqrt and the selects into straight-line vector code.
+inline void pursuitKernel(size_t n, float dt,
+                          float* __restrict x, float* __restrict y, float* __restrict th,
+                          float* __restrict v, float* __restrict w,
+                          const float* __restrict tx, const float* __restrict ty,
+                          const float* __restrict gx, const float* __restrict gy,
+                          const float* __restrict ld, const float* __restrict sp) {
+  for (size_t i = 0; i < n; ++i) {
+    float s, c;
+    sinCos(th[i], s, c);
+    // Target in the robot frame
+    const float dx = tx[i] - x[i], dy = ty[i] - y[i];
+    const float xr = c * dx + s * dy;
+    const float yr = c * dy - s * dx;
+    const float sinAlpha = yr / std::sqrt(xr * xr + yr * yr + 1e-20f); // 0 when the target is the robot
+    const float L = ld[i] > 0.1f ? ld[i] : 0.1f;
+    // Stop within 0.5 cells of the path end
+    const float ex = gx[i] - x[i], ey = gy[i] - y[i];
+    const float vi = float(ex * ex + ey * ey >= 0.25f) * sp[i];
+    const float wi = 2.f * vi * sinAlpha / L;
+    v[i] = vi; w[i] = wi;
+    x[i] += vi * c * dt;
+    y[i] += vi * s * dt;
+    th[i] = wrapPi(th[i] + wi * dt);
+  }
+}
+
+inline void pursuitStep(Robots& r, size_t i0, size_t i1, float dt) {
+  pursuitKernel(i1 - i0, dt, &r.x[i0], &r.y[i0], &r.th[i0], &r.v[i0], &r.w[i0],
+                &r.tx[i0], &r.ty[i0], &r.gx[i0], &r.gy[i0], &r.lookahead[i0], &r.speed[i0]);
+}
+
+struct Stats {
+  long long robotSteps = 0;
+  double errSumSq = 0.0; // squared lateral error after every step
+  long long errCount = 0;
+  double ms = 0.0;
+
+  double rmsError() const { return errCount ? std::sqrt(errSumSq / double(errCount)) : 0.0; }
+  double stepsPerSec() const { return ms > 0.0 ? double(robotSteps) * 1000.0 / ms : 0.0; }
+};
+
+class Simulator {
+public:
+  static constexpr size_t kBlock = 256;
+
+  // threads <= 0 uses std::thread::hardware_concurrency().
+  explicit Simulator(int threads = 0) {
+    threads_ = threads > 0 ? threads : int(std::max(1u, std::thread::hardware_concurrency()));
+  }
+
+  int threads() const { return threads_; }
+
+  // Returns the index robots use to follow this path.
+  uint32_t addPath(std::vector<Vec2f> pts) {
+    paths_.emplace_back(std::move(pts));
+    return uint32_t(paths_.size() - 1);
+  }
+
+  // Add a robot at `pose` following path `path` with the given controller
+  // parameters; returns its index. Ignored (returns size()) for a bad path.
+  size_t addRobot(const RobotState& pose, uint32_t path, const PurePursuit& pp) {
+    if (path >= paths_.size() || paths_[path].size() < 2) return robots_.size();
+    const TrackedPath& tp = paths_[path];
+    robots_.x.push_back(pose.x); robots_.y.push_back(pose.y); robots_.th.push_back(pose.th);
+    robots_.lookahead.push_back(pp.lookahead); robots_.speed.push_back(pp.targetSpeed);
+    robots_.gx.push_back(tp.back().x); robots_.gy.push_back(tp.back().y);
+    robots_.tx.push_back(0.f); robots_.ty.push_back(0.f);
+    robots_.v.push_back(0.f); robots_.w.push_back(0.f);
+    robots_.path.push_back(path);
+    robots_.proj.push_back(tp.project({pose.x, pose.y}, nullptr));
+    return robots_.size() - 1;
+  }
+
+  const std::vector<TrackedPath>& paths() const { return paths_; }
+  const Robots& robots() const { return robots_; }
+  size_t size() const { return robots_.size(); }
+
+  // Advance every robot by `steps` ticks of `dt`.
+  Stats run(int steps, float dt) {
+    Stats total;
+    const size_t n = robots_.size();
+    if (n == 0 || steps <= 0) return total;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const size_t blocks = (n + kBlock - 1) / kBlock;
+    const int nt = int(std::min<size_t>(size_t(threads_), blocks));
+    std::vector<Stats> part(static_cast<size_t>(nt));
+    std::atomic<size_t> next{0};
+    auto work = [&](int t) {
+      Stats local; // published once, so threads never share a cache line while stepping
+      for (size_t b; (b = next.fetch_add(1, std::memory_order_relaxed)) < blocks;) {
+        size_t i0 = b * kBlock, i1 = std::min(n, i0 + kBlock);
+        for (int k = 0; k < steps; ++k) stepBlock(i0, i1, dt, local);
+      }
+      part[size_t(t)] = local;
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < nt; ++t) pool.emplace_back(work, t);
+    work(0);
+    for (std::thread& th : pool) th.join();
+    for (const Stats& s : part) {
+      total.robotSteps += s.robotSteps;
+      total.errSumSq += s.errSumSq;
+      total.errCount += s.errCount;
+    }
+    total.ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    return total;
+  }
+
+private:
+  int threads_ = 1;
+  std::vector<TrackedPath> paths_;
+  Robots robots_;
+
+  void stepBlock(size_t i0, size_t i1, float dt, Stats& st) {
+    Robots& r = robots_;
+    for (size_t i = i0; i < i1; ++i) {
+      const TrackedPath& tp = paths_[r.path[i]];
+      Vec2f t = tp.pointAt(r.proj[i].s + std::max(0.1f, r.lookahead[i]), &r.proj[i]);
+      r.tx[i] = t.x; r.ty[i] = t.y;
+    }
+    pursuitStep(r, i0, i1, dt);
+    for (size_t i = i0; i < i1; ++i) {
+      const TrackedPath& tp = paths_[r.path[i]];
+      const TrackedPath::Projection& p = r.proj[i] = tp.project({r.x[i], r.y[i]}, &r.proj[i]);
+      const double e = double(p.sign * p.dist);
+      st.errSumSq += e * e;
+    }
+    st.errCount += (long long)(i1 - i0);
+    st.robotSteps += (long long)(i1 - i0);
+  }
+};
+
+} // namespace fleet
@@ -0,0 +1,198 @@
+// Headless fleet simulation: plans a set of paths on a makeRandom map, puts
+// robots on them (jittered start poses, varied lookahead and speed) and steps
+// the whole fleet with fleet::Simulator at the sandbox's fixed dt. Reports
+// robot-steps/sec and the RMS lateral error over all robots and ticks.
+//
+//   fleet_sim [--size WxH] [--rects N] [--seed N] [--paths N] [--robots N]
+//             [--seconds S] [--threads N] [--reference 0|1]
+//             [--agents N] [--budget-ms B]
+//
+// --reference 1 (default) also runs the same fleet through the per-robot
+// scalar code the sandbox uses (PurePursuit::control, integrate,
+// lateralError) and prints its throughput and the largest pose difference.
+//
+// --agents N instead plans N agents with distinct random starts and goals,
+// first independently (4-connected A*) and then cooperatively with
+// coop::Planner, and reports plan time, agents/sec and the vertex/swap
+// conflicts of each path set. --budget-ms B bounds the cooperative pass.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "a_star.hpp"
+#include "controller.hpp"
+#include "coop.hpp"
+#include "fleet.hpp"
+#include "map.hpp"
+#include "path_post.hpp"
+#include "static_astar.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// Independent vs. cooperative planning for n agents with distinct cells.
+static int runAgents(const GridMap& map, int n, double budgetMs, std::mt19937& rng) {
+  // Distinct cells: a shuffled prefix of the free cells
+  std::vector<Vec2i> cells;
+  for (int y = 0; y < map.h; ++y)
+    for (int x = 0; x < map.w; ++x)
+      if (map.isFree(x, y)) cells.push_back({x, y});
+  if (size_t(n) * 2 > cells.size()) {
+    std::cerr << "--agents " << n << " needs " << size_t(n) * 2 << " distinct cells, the map has "
+              << cells.size() << " free (at most " << cells.size() / 2 << " agents)\n";
+    return 1;
+  }
+  std::shuffle(cells.begin(), cells.end(), rng);
+  std::vector<coop::Agent> agents;
+  for (int i = 0; i < n; ++i) agents.push_back({cells[2 * size_t(i)], cells[2 * size_t(i) + 1]});
+
+  // Each agent alone: 4-connected moves, one cell per timestep
+  astar::StaticPlanner<astar::Connect4, astar::Manhattan> single;
+  std::vector<std::vector<Vec2i>> paths(agents.size());
+  int found = 0;
+  auto t0 = Clock::now();
+  for (size_t i = 0; i < agents.size(); ++i) found += single.plan(map, agents[i].start, agents[i].goal, paths[i]) ? 1 : 0;
+  const double singleMs = msSince(t0);
+  const coop::Conflicts before = coop::countConflicts(paths, map.w);
+
+  coop::Planner planner;
+  coop::Options opts;
+  opts.budgetMs = budgetMs;
+  planner.plan(map, agents, paths, opts);
+  const coop::Stats& st = planner.lastStats();
+  const coop::Conflicts after = coop::countConflicts(paths, map.w);
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "independent agents=" << n << " found=" << found << " ms=" << singleMs
+            << " conflicts=" << before.total() << " (vertex=" << before.vertex << " swap=" << before.swap << ")\n"
+            << "cooperative planned=" << st.planned << " failed=" << st.failed << " ms=" << st.ms
+            << std::setprecision(1) << " agents/s=" << (st.ms > 0.0 ? 1000.0 * st.planned / st.ms : 0.0)
+            << " conflicts=" << after.total() << " makespan=" << st.makespan << " sum_of_costs=" << st.sumOfCosts
+            << " expanded=" << st.expanded << " settled=" << st.settled << " reservations=" << st.reservations
+            << " table_kb=" << double(st.tableBytes) / 1024.0 << "\n";
+  return after.total() == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  int W = 256, H = 256, rects = 120, paths = 32, robots = 4096, threads = 0, reference = 1, agents = 0;
+  float seconds = 10.f;
+  double budgetMs = 0.0;
+  unsigned seed = 12345u;
+
+  auto parseSize = [](const std::string& s, int& w, int& h) {
+    auto xpos = s.find('x');
+    if (xpos == std::string::npos) return;
+    w = std::max(3, std::atoi(s.substr(0, xpos).c_str()));
+    h = std::max(3, std::atoi(s.substr(xpos + 1).c_str()));
+  };
+  for (int i = 1; i < argc; i += 2) {
+    std::string a = argv[i];
+    if (a == "-h" || a == "--help") {
+      std::cout << "usage: fleet_sim [--size WxH] [--rects N] [--seed N] [--paths N] [--robots N]\n"
+                   "                 [--seconds S] [--threads N] [--reference 0|1]\n"
+                   "                 [--agents N] [--budget-ms B]\n";
+      return 0;
+    }
+    if (i + 1 == argc) { std::cerr << "Missing value for flag '" << a << "'\n"; return 1; }
+    std::string v = argv[i + 1];
+    if (a == "--size") parseSize(v, W, H);
+    else if (a == "--rects") rects = std::max(0, std::atoi(v.c_str()));
+    else if (a == "--seed") seed = static_cast<unsigned>(std::strtoul(v.c_str(), nullptr, 10));
+    else if (a == "--paths") paths = std::max(1, std::atoi(v.c_str()));
+    else if (a == "--robots") robots = std::max(1, std::atoi(v.c_str()));
+    else if (a == "--seconds") seconds = std::max(0.f, float(std::atof(v.c_str())));
+    else if (a == "--threads") threads = std::max(1, std::atoi(v.c_str()));
+    else if (a == "--reference") reference = std::atoi(v.c_str());
+    else if (a == "--agents") agents = std::max(0, std::atoi(v.c_str()));
+    else if (a == "--budget-ms") budgetMs = std::max(0.0, std::atof(v.c_str()));
+    else { std::cerr << "Unknown flag '" << a << "'\n"; return 1; }
+  }
+
+  const float dt = 1.f / 120.f;
+  const int steps = int(std::lround(seconds / dt));
+
+  GridMap map;
+  map.makeRandom(W, H, rects, 3, 12, seed);
+  std::mt19937 rng(seed);
+  if (agents > 0) {
+    std::cout << "map " << W << "x" << H << " rects=" << rects << "\n";
+    return runAgents(map, agents, budgetMs, rng);
+  }
+  std::uniform_int_distribution<int> xd(0, W - 1), yd(0, H - 1);
+  auto freeCell = [&]() {
+    for (;;) { Vec2i c{xd(rng), yd(rng)}; if (map.isFree(c.x, c.y)) return c; }
+  };
+
+  fleet::Simulator sim(threads);
+  astar::Planner planner;
+  postproc::Pipeline post;
+  std::vector<Vec2i> cells;
+  std::vector<Vec2f> smooth;
+  for (int tries = 0; int(sim.paths().size()) < paths && tries < paths * 20; ++tries) {
+    if (!planner.plan(map, freeCell(), freeCell(), cells) || cells.size() < 8) continue;
+    post.run(&map, cells, smooth);
+    sim.addPath(smooth);
+  }
+  if (sim.paths().empty()) { std::cerr << "No paths found\n"; return 1; }
+
+  std::uniform_real_distribution<float> jitter(-0.3f, 0.3f), la(1.5f, 3.f), spd(1.5f, 2.5f);
+  std::vector<RobotState> poses;
+  std::vector<PurePursuit> ctrls;
+  for (int i = 0; i < robots; ++i) {
+    uint32_t p = uint32_t(i) % uint32_t(sim.paths().size());
+    const TrackedPath& tp = sim.paths()[p];
+    Vec2f d = tp[1] - tp[0];
+    RobotState s{tp[0].x + jitter(rng), tp[0].y + jitter(rng), std::atan2(d.y, d.x) + jitter(rng)};
+    PurePursuit c{la(rng), spd(rng)};
+    sim.addRobot(s, p, c);
+    poses.push_back(s);
+    ctrls.push_back(c);
+  }
+
+  std::cout << "map " << W << "x" << H << " paths=" << sim.paths().size() << " robots=" << sim.size()
+            << " steps=" << steps << " threads=" << sim.threads() << "\n";
+  fleet::Stats st = sim.run(steps, dt);
+  std::cout << std::fixed << std::setprecision(1)
+            << "soa        robot_steps/s=" << st.stepsPerSec()
+            << std::setprecision(4) << " rms_err=" << st.rmsError() << " ms=" << st.ms << "\n";
+
+  if (reference) {
+    // The sandbox's per-robot loop, one TrackedPath per robot
+    double errSumSq = 0.0; long long errCount = 0;
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < poses.size(); ++i) {
+      TrackedPath tp(sim.paths()[sim.robots().path[i]].points());
+      RobotState& s = poses[i];
+      for (int k = 0; k < steps; ++k) {
+        auto [v, w] = ctrls[i].control(s, tp);
+        Vec2f g = tp.back();
+        float gx = g.x - s.x, gy = g.y - s.y;
+        if (std::sqrt(gx*gx + gy*gy) < 0.5f) { v = 0.f; w = 0.f; }
+        integrate(s, v, w, dt);
+        float err = lateralError(s, tp);
+        errSumSq += double(err) * double(err);
+        ++errCount;
+      }
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    float maxDiff = 0.f;
+    for (size_t i = 0; i < poses.size(); ++i)
+      maxDiff = std::max(maxDiff, std::hypot(poses[i].x - sim.robots().x[i], poses[i].y - sim.robots().y[i]));
+    double rms = errCount ? std::sqrt(errSumSq / double(errCount)) : 0.0;
+    std::cout << std::setprecision(1)
+              << "scalar@1   robot_steps/s=" << (ms > 0.0 ? double(errCount) * 1000.0 / ms : 0.0)
+              << std::setprecision(4) << " rms_err=" << rms << " ms=" << ms
+              << " max_pose_diff=" << maxDiff << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "a_star.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+#include "open_list.hpp"
+#include "profiler.hpp"
+
+// Goal-rooted distance field for many starts sharing one goal. build() runs a
+// single reverse Dijkstra from the goal over the whole reachable map (same
+// 8-connected moves and step costs as astar::Planner) and stores, per cell,
+// the path cost to the goal and the direction of the next cell on an optimal
+// path. A path from any start is then read off by following those
+// directions, in time proportional to its length. plan() keeps the field
+// until the goal changes or sync()/cellChanged() report an occupancy edit;
+// an edit rebuilds the whole field on the next plan().
+namespace flow {
+
+class FlowField {
+public:
+  static constexpr uint8_t kGoal = 8;          // direction stored at the goal
+  static constexpr uint8_t kUnreachable = 255; // direction of cells with no path
+
+  // Invalidate the field if `map` differs from the occupancy it was built on
+  // (checking only the rectangles its journal reports as edited).
+  void sync(const GridMap& map) {
+    if (!ready_) return;
+    if (map.w != w_ || map.h != h_) { ready_ = false; return; }
+    forEachChange(map, built_, occ_, [&](int, int) { return ready_ = false; });
+    if (ready_) built_ = map.version();
+  }
+
+  // Notify the field that cell (x, y) of `map` changed occupancy.
+  void cellChanged(const GridMap& map, int x, int y) {
+    if (!ready_ || !map.inBounds(x, y) || map.w != w_ || map.h != h_) return;
+    const size_t id = size_t(astar::idx(x, y, w_));
+    if ((map.occ[id] ? 1 : 0) != (occ_[id] ? 1 : 0)) ready_ = false;
+  }
+
+  // While *flag is true, build() stops and leaves the field invalid.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; }
+
+  bool ready() const { return ready_; }
+  Vec2i goal() const { return goal_; }
+  // True if the last plan() call built the field instead of reusing it.
+  bool lastBuilt() const { return lastBuilt_; }
+  long long builds() const { return builds_; }
+
+  // Path cost from (x, y) to the goal; infinity if unreachable or not built.
+  float distance(int x, int y) const {
+    if (!ready_ || x < 0 || y < 0 || x >= w_ || y >= h_) return kInf;
+    return dist_[size_t(astar::idx(x, y, w_))];
+  }
+
+  // Direction index (as in freeMask) of the next step from (x, y), kGoal at
+  // the goal or kUnreachable.
+  uint8_t direction(int x, int y) const {
+    if (!ready_ || x < 0 || y < 0 || x >= w_ || y >= h_) return kUnreachable;
+    return dir_[size_t(astar::idx(x, y, w_))];
+  }
+
+  // Compute the field for `goal`. Returns false if the goal is blocked or
+  // the build was cancelled.
+  bool build(const GridMap& map, Vec2i goal) {
+    PP_PROF_SCOPE("flow.build");
+    ready_ = false;
+    if (!map.inBounds(goal.x, goal.y) || !map.isFree(goal.x, goal.y)) return false;
+    const int w = map.w;
+    const size_t n = size_t(w) * size_t(map.h);
+    if (map.w != w_ || map.h != h_) {
+      w_ = map.w; h_ = map.h;
+      dist_.resize(n);
+      dir_.resize(n);
+      open_.reset(n);
+    }
+    occ_ = map.occ;
+    built_ = map.version();
+    goal_ = goal;
+    std::fill(dist_.begin(), dist_.end(), kInf);
+    std::fill(dir_.begin(), dir_.end(), kUnreachable);
+    open_.clear();
+
+    const int t = astar::idx(goal.x, goal.y, w);
+    dist_[size_t(t)] = 0.f;
+    dir_[size_t(t)] = kGoal;
+    open_.push(t, 0.f);
+    // Moves only need their destination free, so the reverse of an edge is
+    // an edge with the same cost: expanding v relaxes each free neighbour u,
+    // whose next step back towards v is the opposite direction (k + 4) % 8.
+    while (!open_.empty()) {
+      if (cancel_.poll()) return false;
+      const int id = open_.pop();
+      const int cx = id % w, cy = id / w;
+      const unsigned freeDirs = map.freeMask(cx, cy);
+      const float d = dist_[size_t(id)];
+      for (int k = 0; k < 8; ++k) {
+        if (!((freeDirs >> k) & 1u)) continue;
+        const int nid = astar::idx(cx + kDx[k], cy + kDy[k], w);
+        const float nd = d + kCost[k];
+        if (nd < dist_[size_t(nid)]) {
+          dist_[size_t(nid)] = nd;
+          dir_[size_t(nid)] = uint8_t((k + 4) & 7);
+          open_.push(nid, nd);
+        }
+      }
+    }
+    ready_ = true;
+    ++builds_;
+    return true;
+  }
+
+  // Path from `start` to the field's goal by following the stored
+  // directions; out is cleared first. Returns false if unreachable.
+  bool extract(Vec2i start, std::vector<Vec2i>& out) const {
+    out.clear();
+    if (direction(start.x, start.y) == kUnreachable) return false;
+    Vec2i c = start;
+    out.push_back(c);
+    for (uint8_t k; (k = dir_[size_t(astar::idx(c.x, c.y, w_))]) != kGoal;) {
+      c = {c.x + kDx[k], c.y + kDy[k]};
+      out.push_back(c);
+    }
+    return true;
+  }
+
+  std::vector<Vec2i> plan(const GridMap& map, Vec2i start, Vec2i goal) {
+    std::vector<Vec2i> path;
+    plan(map, start, goal, path);
+    return path;
+  }
+
+  // Reuses the field unless the goal, the map size or (per sync/cellChanged)
+  // the occupancy changed. Writes the path into `out` (cleared first).
+  bool plan(const GridMap& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    out.clear();
+    lastBuilt_ = false;
+    if (!map.inBounds(start.x, start.y) || !map.isFree(start.x, start.y)) return false;
+    if (!ready_ || map.w != w_ || map.h != h_ || goal != goal_) {
+      lastBuilt_ = true;
+      if (!build(map, goal)) return false;
+    }
+    return extract(start, out);
+  }
+
+private:
+  static constexpr float kInf = std::numeric_limits<float>::infinity();
+  static constexpr int kDx[8] = {1,1,0,-1,-1,-1,0,1};
+  static constexpr int kDy[8] = {0,1,1,1,0,-1,-1,-1};
+  static constexpr float kSqrt2 = 1.41421356f;
+  static constexpr float kCost[8] = {1, kSqrt2, 1, kSqrt2, 1, kSqrt2, 1, kSqrt2};
+
+  astar::CancelFlag cancel_;
+  bool ready_ = false, lastBuilt_ = false;
+  long long builds_ = 0;
+  int w_ = 0, h_ = 0;
+  Vec2i goal_{0, 0};
+  std::vector<uint8_t> occ_; // occupancy the field was built on
+  MapVersion built_;         // a map version with that occupancy
+  std::vector<float> dist_;
+  std::vector<uint8_t> dir_;
+  astar::IndexedHeap4 open_;
+};
+
+} // namespace flow
@@ -0,0 +1,23 @@
+#pragma once
+
+// Minimal 2D vector types used by the planning core. They mirror the parts of
+// sf::Vector2i / sf::Vector2f the planner and controllers need so the core
+// headers build without SFML (headless servers, batch tools).
+
+struct Vec2i {
+  int x{0}, y{0};
+  bool operator==(const Vec2i& o) const { return x == o.x && y == o.y; }
+  bool operator!=(const Vec2i& o) const { return !(*this == o); }
+};
+
+struct Vec2f {
+  float x{0.f}, y{0.f};
+  Vec2f& operator+=(const Vec2f& o) { x += o.x; y += o.y; return *this; }
+  Vec2f& operator-=(const Vec2f& o) { x -= o.x; y -= o.y; return *this; }
+};
+
+inline Vec2f operator+(Vec2f a, Vec2f b) { return {a.x + b.x, a.y + b.y}; }
+inline Vec2f operator-(Vec2f a, Vec2f b) { return {a.x - b.x, a.y - b.y}; }
+inline Vec2f operator*(Vec2f a, float s) { return {a.x * s, a.y * s}; }
+inline Vec2f operator*(float s, Vec2f a) { return {a.x * s, a.y * s}; }
+inline Vec2f operator/(Vec2f a, float s) { return {a.x / s, a.y / s}; }
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include "a_star.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+
+// Hierarchical path planning (HPA*, Botea et al.). The grid is split into
+// square clusters; entrances are found along shared cluster borders and the
+// distances between entrances of one cluster are precomputed. A query first
+// searches this small abstract graph, then refines each hop with a search
+// confined to one cluster. Paths are near-optimal (typically within a few
+// percent of A*). Cell edits only rebuild the clusters (and borders) they touch.
+namespace hpa {
+
+class Planner {
+public:
+  explicit Planner(int clusterSize = 16) : C_(std::max(4, clusterSize)) {}
+
+  int clusterSize() const { return C_; }
+  size_t abstractNodes() const {
+    size_t n = 0;
+    for (auto& c : clusters_) n += c.nodes.size();
+    return n;
+  }
+  // Clusters rebuilt by the most recent preprocessing update.
+  int lastRebuilt() const { return lastRebuilt_; }
+
+  // Full preprocessing of `map`.
+  void build(const GridMap& map) {
+    w_ = map.w; h_ = map.h;
+    occ_.assign(map.occ.begin(), map.occ.end());
+    for (auto& o : occ_) o = o ? 1 : 0;
+    synced_ = map.version();
+    ncx_ = (w_ + C_ - 1) / C_;
+    ncy_ = (h_ + C_ - 1) / C_;
+    clusters_.assign(size_t(ncx_) * ncy_, Cluster{});
+    vBorder_.assign(clusters_.size(), {});
+    hBorder_.assign(clusters_.size(), {});
+    corner_.assign(clusters_.size(), {});
+    borderDirty_.assign(clusters_.size() * 3, 1);
+    clusterDirty_.assign(clusters_.size(), 1);
+    built_ = true;
+    flush();
+  }
+
+  // Record an edit of cell (x, y); affected clusters are rebuilt lazily on
+  // the next plan().
+  void cellChanged(const GridMap& map, int x, int y) {
+    if (!built_ || !map.inBounds(x, y)) return;
+    int id = astar::idx(x, y, w_);
+    uint8_t v = map.occ[id] ? 1 : 0;
+    if (occ_[id] == v) return;
+    occ_[id] = v;
+    int cx = x / C_, cy = y / C_;
+    clusterDirty_[cid(cx, cy)] = 1;
+    if (x % C_ == 0 && cx > 0) markBorder(true, cx - 1, cy);
+    if (x % C_ == C_ - 1 && cx < ncx_ - 1) markBorder(true, cx, cy);
+    if (y % C_ == 0 && cy > 0) markBorder(false, cx, cy - 1);
+    if (y % C_ == C_ - 1 && cy < ncy_ - 1) markBorder(false, cx, cy);
+    const int ccx = (x % C_ == 0) ? cx - 1 : (x % C_ == C_ - 1) ? cx : -1;
+    const int ccy = (y % C_ == 0) ? cy - 1 : (y % C_ == C_ - 1) ? cy : -1;
+    if (ccx >= 0 && ccy >= 0 && ccx < ncx_ - 1 && ccy < ncy_ - 1) markCorner(ccx, ccy);
+  }
+
+  // Diff `map` against the preprocessed snapshot and mark what changed
+  // (only inside the rectangles its journal reports since the last sync).
+  void sync(const GridMap& map) {
+    if (!built_ || map.w != w_ || map.h != h_) { built_ = false; return; }
+    forEachChange(map, synced_, occ_, [&](int x, int y) { cellChanged(map, x, y); return true; });
+    synced_ = map.version();
+  }
+
+  std::vector<Vec2i> plan(const GridMap& map, Vec2i start, Vec2i goal) {
+    std::vector<Vec2i> path;
+    plan(map, start, goal, path);
+    return path;
+  }
+
+  // While *flag is true, plan() abandons its abstract search or refinement
+  // and returns false. Cluster rebuilds always run to completion.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; }
+
+  bool plan(const GridMap& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    out.clear();
+    if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return false;
+    if (!built_ || map.w != w_ || map.h != h_) build(map);
+    else flush();
+    const int s = astar::idx(start.x, start.y, w_), t = astar::idx(goal.x, goal.y, w_);
+    if (occ_[s] || occ_[t]) return false;
+
+    // Connect start and goal to the entrances of their clusters
+    const int ks = clusterOf(s), kt = clusterOf(t);
+    localSearch(ks, s, false);
+    collect(ks, startDist_);
+    localSearch(kt, t, false);
+    collect(kt, goalDist_);
+    // Nearby endpoints: also try a direct search over the clusters' bounding
+    // box, which avoids long detours through entrances on short queries
+    float direct = kInf;
+    const Rect near = unionRect(ks, kt);
+    const bool adjacent = std::abs(ks % ncx_ - kt % ncx_) <= 1 && std::abs(ks / ncx_ - kt / ncx_) <= 1;
+    if (adjacent) {
+      localSearch(near, s, false);
+      direct = ldist_[local(t)];
+    }
+
+    // A* over the abstract graph; keys are cell ids, start/goal are virtual
+    const int kStart = -2, kGoal = -3;
+    recs_.clear();
+    open_.clear();
+    auto rec = [&](int key) -> Rec& {
+      auto it = recs_.find(key);
+      if (it == recs_.end()) it = recs_.emplace(key, Rec{}).first;
+      return it->second;
+    };
+    auto hOf = [&](int cell) { return astar::heuristic(cell % w_, cell / w_, goal.x, goal.y); };
+    auto relax = [&](int from, int to, int toCell, float g) {
+      Rec& r = rec(to);
+      if (g < r.g) {
+        r.g = g; r.parent = from;
+        open_.push_back({g + (to == kGoal ? 0.f : hOf(toCell)), to});
+        std::push_heap(open_.begin(), open_.end());
+      }
+    };
+    rec(kStart).g = 0.f;
+    open_.push_back({hOf(s), kStart});
+
+    bool found = false;
+    while (!open_.empty()) {
+      if (cancel_.poll()) return false;
+      std::pop_heap(open_.begin(), open_.end());
+      QItem q = open_.back(); open_.pop_back();
+      Rec& r = rec(q.key);
+      if (r.closed) continue;
+      r.closed = true;
+      const float g = r.g;
+      if (q.key == kGoal) { found = true; break; }
+
+      if (q.key == kStart) {
+        const Cluster& c = clusters_[ks];
+        for (size_t j = 0; j < c.nodes.size(); ++j)
+          if (startDist_[j] < kInf) relax(kStart, c.nodes[j], c.nodes[j], startDist_[j]);
+        if (direct < kInf) relax(kStart, kGoal, t, direct);
+        continue;
+      }
+
+      const int cell = q.key, k = clusterOf(cell);
+      const Cluster& c = clusters_[k];
+      const int i = nodeIndex(c, cell);
+      const size_t n = c.nodes.size();
+      for (size_t j = 0; j < n; ++j) {
+        float d = c.dist[i * n + j];
+        if (int(j) != i && d < kInf) relax(cell, c.nodes[j], c.nodes[j], g + d);
+      }
+      for (int p : c.partners[i]) relax(cell, p, p, g + stepCost(cell, p));
+      if (k == kt && goalDist_[i] < kInf) relax(cell, kGoal, t, g + goalDist_[i]);
+    }
+    if (!found) return false;
+
+    // Walk back the abstract path and refine each hop into grid cells
+    hops_.clear();
+    for (int key = kGoal; key != -1; key = recs_[key].parent) {
+      hops_.push_back(key == kGoal ? t : key == kStart ? s : key);
+      if (key == kStart) break;
+    }
+    std::reverse(hops_.begin(), hops_.end());
+    out.push_back(start);
+    for (size_t i = 1; i < hops_.size(); ++i) {
+      if (cancel_.flag && cancel_.flag->load(std::memory_order_relaxed)) { out.clear(); return false; }
+      int a = hops_[i - 1], b = hops_[i];
+      if (a == b) continue;
+      if (hops_.size() == 2 && adjacent) { refine(near, a, b, out); continue; }
+      if (clusterOf(a) != clusterOf(b)) { out.push_back({b % w_, b / w_}); continue; }
+      refine(clusterRect(clusterOf(a)), a, b, out);
+    }
+    return true;
+  }
+
+private:
+  struct Cluster {
+    std::vector<int> nodes;                  // entrance cells inside the cluster
+    std::vector<float> dist;                 // nodes x nodes intra-cluster distances
+    std::vector<std::vector<int>> partners;  // per node: entrance cells across borders
+  };
+  struct Rect { int x0, y0, x1, y1; }; // half-open cell bounds
+  struct Rec { float g = std::numeric_limits<float>::infinity(); int parent = -1; bool closed = false; };
+  struct QItem {
+    float f; int key;
+    bool operator<(const QItem& o) const { return f > o.f; } // min-heap
+  };
+  struct LItem {
+    float d; int id;
+    bool operator<(const LItem& o) const { return d > o.d; }
+  };
+
+  static constexpr float kInf = std::numeric_limits<float>::infinity();
+
+  int C_;
+  bool built_ = false;
+  int w_ = 0, h_ = 0, ncx_ = 0, ncy_ = 0;
+  int lastRebuilt_ = 0;
+  astar::CancelFlag cancel_;
+  std::vector<uint8_t> occ_;
+  MapVersion synced_; // map version occ_ was last synced to
+  std::vector<Cluster> clusters_;
+  std::vector<std::vector<std::pair<int, int>>> vBorder_; // (cx,cy)|(cx+1,cy) transitions
+  std::vector<std::vector<std::pair<int, int>>> hBorder_; // (cx,cy)|(cx,cy+1) transitions
+  std::vector<std::vector<std::pair<int, int>>> corner_;  // diagonal hops around (cx,cy)'s SE corner
+  std::vector<uint8_t> borderDirty_, clusterDirty_;
+
+  // Query scratch, reused between calls
+  std::unordered_map<int, Rec> recs_;
+  std::vector<QItem> open_;
+  std::vector<float> startDist_, goalDist_; // start/goal edges to their clusters' entrances
+  std::vector<int> hops_;
+  Rect lrect_{0, 0, 0, 0};
+  std::vector<float> ldist_;
+  std::vector<int> lparent_;
+  std::vector<LItem> lheap_;
+
+  int cid(int cx, int cy) const { return cy * ncx_ + cx; }
+  int clusterOf(int cell) const { return cid((cell % w_) / C_, (cell / w_) / C_); }
+
+  // Border between (cx, cy) and its east (vertical) or south neighbor.
+  void markBorder(bool vertical, int cx, int cy) {
+    borderDirty_[size_t(cid(cx, cy)) * 3 + (vertical ? 0 : 1)] = 1;
+    clusterDirty_[cid(cx, cy)] = 1;
+    clusterDirty_[vertical ? cid(cx + 1, cy) : cid(cx, cy + 1)] = 1;
+  }
+
+  // The four clusters meeting at the SE corner of (cx, cy).
+  void markCorner(int cx, int cy) {
+    borderDirty_[size_t(cid(cx, cy)) * 3 + 2] = 1;
+    clusterDirty_[cid(cx, cy)] = clusterDirty_[cid(cx + 1, cy)] = 1;
+    clusterDirty_[cid(cx, cy + 1)] = clusterDirty_[cid(cx + 1, cy + 1)] = 1;
+  }
+
+  float stepCost(int a, int b) const {
+    return (a % w_ != b % w_ && a / w_ != b / w_) ? std::sqrt(2.f) : 1.f;
+  }
+
+  static int nodeIndex(const Cluster& c, int cell) {
+    for (size_t i = 0; i < c.nodes.size(); ++i)
+      if (c.nodes[i] == cell) return int(i);
+    return -1;
+  }
+
+  // Entrances: maximal runs of free cell pairs across the border; short runs
+  // get one transition in the middle, long runs one at each end. A diagonal
+  // step that no straight pair can replace gets its own transition.
+  void buildBorder(bool vertical, int cx, int cy) {
+    auto& list = vertical ? vBorder_[cid(cx, cy)] : hBorder_[cid(cx, cy)];
+    list.clear();
+    const int lo = vertical ? cy * C_ : cx * C_;
+    const int hi = vertical ? std::min(h_, lo + C_) : std::min(w_, lo + C_);
+    const int fixedA = vertical ? std::min(w_, (cx + 1) * C_) - 1 : std::min(h_, (cy + 1) * C_) - 1;
+    auto cells = [&](int i, int& a, int& b) {
+      if (vertical) { a = astar::idx(fixedA, i, w_); b = a + 1; }
+      else { a = astar::idx(i, fixedA, w_); b = a + w_; }
+    };
+    int runStart = -1;
+    for (int i = lo; i <= hi; ++i) {
+      bool open = false;
+      if (i < hi) { int a, b; cells(i, a, b); open = !occ_[a] && !occ_[b]; }
+      if (open && runStart < 0) runStart = i;
+      if (!open && runStart >= 0) {
+        int end = i - 1, a, b;
+        if (end - runStart + 1 < 6) {
+          cells((runStart + end) / 2, a, b); list.push_back({a, b});
+        } else {
+          cells(runStart, a, b); list.push_back({a, b});
+          cells(end, a, b); list.push_back({a, b});
+        }
+        runStart = -1;
+      }
+    }
+    for (int i = lo; i + 1 < hi; ++i) {
+      int a0, b0, a1, b1;
+      cells(i, a0, b0); cells(i + 1, a1, b1);
+      if (occ_[b0] && occ_[a1] && !occ_[a0] && !occ_[b1]) list.push_back({a0, b1});
+      if (occ_[a0] && occ_[b1] && !occ_[b0] && !occ_[a1]) list.push_back({a1, b0});
+    }
+  }
+
+  // Diagonal hops across the point where four clusters meet, needed only
+  // when both cells that would route around the corner are blocked.
+  void buildCorner(int cx, int cy) {
+    auto& list = corner_[cid(cx, cy)];
+    list.clear();
+    const int X = (cx + 1) * C_, Y = (cy + 1) * C_;
+    const int tl = astar::idx(X - 1, Y - 1, w_), tr = astar::idx(X, Y - 1, w_);
+    const int bl = astar::idx(X - 1, Y, w_), br = astar::idx(X, Y, w_);
+    if (!occ_[tl] && !occ_[br] && occ_[tr] && occ_[bl]) list.push_back({tl, br});
+    if (!occ_[tr] && !occ_[bl] && occ_[tl] && occ_[br]) list.push_back({tr, bl});
+  }
+
+  void buildCluster(int cx, int cy) {
+    Cluster& c = clusters_[cid(cx, cy)];
+    c.nodes.clear();
+    c.partners.clear();
+    auto addLink = [&](int inside, int across) {
+      int i = nodeIndex(c, inside);
+      if (i < 0) { i = int(c.nodes.size()); c.nodes.push_back(inside); c.partners.emplace_back(); }
+      c.partners[i].push_back(across);
+    };
+    if (cx > 0) for (auto& e : vBorder_[cid(cx - 1, cy)]) addLink(e.second, e.first);
+    if (cx < ncx_ - 1) for (auto& e : vBorder_[cid(cx, cy)]) addLink(e.first, e.second);
+    if (cy > 0) for (auto& e : hBorder_[cid(cx, cy - 1)]) addLink(e.second, e.first);
+    if (cy < ncy_ - 1) for (auto& e : hBorder_[cid(cx, cy)]) addLink(e.first, e.second);
+    const int k = cid(cx, cy);
+    for (int oy = cy - 1; oy <= cy; ++oy)
+      for (int ox = cx - 1; ox <= cx; ++ox) {
+        if (ox < 0 || oy < 0 || ox >= ncx_ - 1 || oy >= ncy_ - 1) continue;
+        for (auto& e : corner_[cid(ox, oy)]) {
+          if (clusterOf(e.first) == k) addLink(e.first, e.second);
+          else if (clusterOf(e.second) == k) addLink(e.second, e.first);
+        }
+      }
+
+    const size_t n = c.nodes.size();
+    c.dist.assign(n * n, kInf);
+    for (size_t i = 0; i < n; ++i) {
+      localSearch(k, c.nodes[i], false);
+      for (size_t j = 0; j < n; ++j) c.dist[i * n + j] = ldist_[local(c.nodes[j])];
+    }
+  }
+
+  void flush() {
+    lastRebuilt_ = 0;
+    for (int cy = 0; cy < ncy_; ++cy)
+      for (int cx = 0; cx < ncx_; ++cx) {
+        size_t b = size_t(cid(cx, cy)) * 3;
+        if (borderDirty_[b] && cx < ncx_ - 1) buildBorder(true, cx, cy);
+        if (borderDirty_[b + 1] && cy < ncy_ - 1) buildBorder(false, cx, cy);
+        if (borderDirty_[b + 2] && cx < ncx_ - 1 && cy < ncy_ - 1) buildCorner(cx, cy);
+        borderDirty_[b] = borderDirty_[b + 1] = borderDirty_[b + 2] = 0;
+      }
+    for (int cy = 0; cy < ncy_; ++cy)
+      for (int cx = 0; cx < ncx_; ++cx) {
+        if (!clusterDirty_[cid(cx, cy)]) continue;
+        buildCluster(cx, cy);
+        clusterDirty_[cid(cx, cy)] = 0;
+        ++lastRebuilt_;
+      }
+  }
+
+  Rect clusterRect(int k) const {
+    int x0 = (k % ncx_) * C_, y0 = (k / ncx_) * C_;
+    return {x0, y0, std::min(w_, x0 + C_), std::min(h_, y0 + C_)};
+  }
+
+  Rect unionRect(int ka, int kb) const {
+    Rect a = clusterRect(ka), b = clusterRect(kb);
+    return {std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+  }
+
+  // Index of `cell` in the scratch arrays of the last local search.
+  int local(int cell) const {
+    return (cell / w_ - lrect_.y0) * (lrect_.x1 - lrect_.x0) + (cell % w_ - lrect_.x0);
+  }
+
+  void collect(int k, std::vector<float>& d) const {
+    const Cluster& c = clusters_[k];
+    d.resize(c.nodes.size());
+    for (size_t j = 0; j < c.nodes.size(); ++j) d[j] = ldist_[local(c.nodes[j])];
+  }
+
+  void localSearch(int k, int src, bool parents) { localSearch(clusterRect(k), src, parents); }
+
+  // Dijkstra from `src` confined to rectangle r; fills ldist_ (and lparent_).
+  void localSearch(const Rect& r, int src, bool parents) {
+    lrect_ = r;
+    const size_t n = size_t(r.x1 - r.x0) * (r.y1 - r.y0);
+    ldist_.assign(n, kInf);
+    if (parents) lparent_.assign(n, -1);
+    lheap_.clear();
+    ldist_[local(src)] = 0.f;
+    lheap_.push_back({0.f, src});
+    const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    while (!lheap_.empty()) {
+      std::pop_heap(lheap_.begin(), lheap_.end());
+      LItem it = lheap_.back(); lheap_.pop_back();
+      if (it.d > ldist_[local(it.id)]) continue;
+      int x = it.id % w_, y = it.id / w_;
+      for (int d = 0; d < 8; ++d) {
+        int nx = x + dx[d], ny = y + dy[d];
+        if (nx < r.x0 || ny < r.y0 || nx >= r.x1 || ny >= r.y1) continue;
+        int nid = astar::idx(nx, ny, w_);
+        if (occ_[nid]) continue;
+        float nd = it.d + ((d & 1) ? std::sqrt(2.f) : 1.f);
+        int li = local(nid);
+        if (nd < ldist_[li]) {
+          ldist_[li] = nd;
+          if (parents) lparent_[li] = it.id;
+          lheap_.push_back({nd, nid});
+          std::push_heap(lheap_.begin(), lheap_.end());
+        }
+      }
+    }
+  }
+
+  // Append the cells after `a` up to and including `b`, both inside r.
+  void refine(const Rect& r, int a, int b, std::vector<Vec2i>& out) {
+    localSearch(r, b, true); // search from b so parents lead towards it
+    for (int cur = lparent_[local(a)]; cur != -1; cur = lparent_[local(cur)]) {
+      out.push_back({cur % w_, cur / w_});
+      if (cur == b) break;
+    }
+  }
+};
+
+} // namespace hpa
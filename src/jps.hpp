@@ -0,0 +1,293 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "a_star.hpp"
+#include "bitgrid.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+
+// Jump Point Search over the same 8-connected, uniform-cost grid model as
+// astar::Planner (a diagonal step only needs its destination cell free), so
+// path costs match A* exactly. Straight jumps scan 64 cells per step on
+// packed row/column bitsets; the returned path is expanded back to every
+// grid cell so toFloatCenter/chaikin consume it unchanged.
+namespace jps {
+
+// Blocked-cell bitset for a set of parallel lines (grid rows or columns).
+// Every line is padded with set bits on both ends and there is one all-set
+// line above and below, so scans stop at the border without bounds checks.
+struct LineBits {
+  static constexpr int kPad = 128; // bits of padding before position 0
+  int lines = 0, len = 0, stride = 0;
+  std::vector<uint64_t> words;
+
+  void reset(int nLines, int n) {
+    lines = nLines; len = n;
+    stride = (kPad + n + 192 + 63) / 64;
+    words.assign(size_t(nLines + 2) * stride, ~uint64_t(0));
+  }
+
+  void set(int line, int pos, bool blocked) {
+    int b = pos + kPad;
+    uint64_t& word = words[size_t(line + 1) * stride + (b >> 6)];
+    uint64_t m = uint64_t(1) << (b & 63);
+    word = blocked ? (word | m) : (word & ~m);
+  }
+
+  // Valid for line in [-1, lines] and pos in [-1, len].
+  bool get(int line, int pos) const {
+    int b = pos + kPad;
+    return (words[size_t(line + 1) * stride + (b >> 6)] >> (b & 63)) & 1u;
+  }
+
+  // 64 bits starting at padded bit index `bit` of `line` (bit 0 = lowest).
+  uint64_t window(int line, int bit) const {
+    const uint64_t* row = &words[size_t(line + 1) * stride];
+    int i = bit >> 6, off = bit & 63;
+    uint64_t lo = row[i] >> off;
+    return off ? (lo | (row[i + 1] << (64 - off))) : lo;
+  }
+
+  // Walk from `pos` along `line` in direction `dir` (+1/-1). Returns the first
+  // cell that is a jump point (has a forced neighbor on an adjacent line) or
+  // `target`, whichever comes first; -2 if a blocked cell is hit first.
+  int scan(int line, int pos, int dir, int target) const {
+    const int K = kPad;
+    if (dir > 0) {
+      for (int P = pos + 1 + K;; P += 64) {
+        uint64_t b = window(line, P);
+        uint64_t u = window(line - 1, P), u1 = window(line - 1, P + 1);
+        uint64_t d = window(line + 1, P), d1 = window(line + 1, P + 1);
+        uint64_t stop = b | (u & ~u1) | (d & ~d1);
+        if (!stop) continue;
+        int c = P + bits::ctz64(stop) - K;
+        if (target > pos && target <= c) return target;
+        return ((b >> (c + K - P)) & 1u) ? -2 : c;
+      }
+    } else {
+      for (int P = pos - 1 + K;; P -= 64) {
+        uint64_t b = window(line, P - 63);
+        uint64_t u = window(line - 1, P - 63), u1 = window(line - 1, P - 64);
+        uint64_t d = window(line + 1, P - 63), d1 = window(line + 1, P - 64);
+        uint64_t stop = b | (u & ~u1) | (d & ~d1);
+        if (!stop) continue;
+        int bit = 63 - bits::clz64(stop);
+        int c = P - 63 + bit - K;
+        if (target >= 0 && target < pos && target >= c) return target;
+        return ((b >> bit) & 1u) ? -2 : c;
+      }
+    }
+  }
+};
+
+class Planner {
+public:
+  // Bring the packed occupancy up to date with `map`: only the rectangles
+  // its journal reports since the last sync, or a full repack after a
+  // regeneration or load. plan() repacks automatically when the size changes.
+  void sync(const GridMap& map) {
+    if (map.w == mw_ && map.h == mh_ && map.changesSince(synced_, dirty_)) {
+      for (const DirtyRect& r : dirty_)
+        for (int y = r.y0; y < r.y1; ++y)
+          for (int x = r.x0; x < r.x1; ++x) syncCell(map, x, y);
+    } else {
+      rows_.reset(map.h, map.w);
+      cols_.reset(map.w, map.h);
+      for (int y = 0; y < map.h; ++y)
+        for (int x = 0; x < map.w; ++x) syncCell(map, x, y);
+      mw_ = map.w; mh_ = map.h;
+    }
+    synced_ = map.version();
+  }
+
+  // Refresh a single edited cell (e.g. after GridMap::toggle).
+  void syncCell(const GridMap& map, int x, int y) {
+    if (!map.inBounds(x, y)) return;
+    bool b = !map.isFree(x, y);
+    rows_.set(y, x, b);
+    cols_.set(x, y, b);
+  }
+
+  // While *flag is true, plan() abandons its search and returns false.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; }
+
+  std::vector<Vec2i> plan(const GridMap& map, Vec2i start, Vec2i goal) {
+    std::vector<Vec2i> path;
+    plan(map, start, goal, path);
+    return path;
+  }
+
+  bool plan(const GridMap& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    out.clear();
+    if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return false;
+    if (!map.isFree(start.x, start.y) || !map.isFree(goal.x, goal.y)) return false;
+    if (map.w != mw_ || map.h != mh_) sync(map);
+
+    const int w = map.w;
+    prepare(map.w, map.h);
+    goal_ = goal;
+
+    int s = astar::idx(start.x, start.y, w), t = astar::idx(goal.x, goal.y, w);
+    touch(s);
+    g_[s] = 0.f;
+    push({start.x, start.y, astar::heuristic(start.x, start.y, goal.x, goal.y)});
+
+    bool found = false;
+    while (!open_.empty()) {
+      if (cancel_.poll()) return false;
+      astar::Node n = pop();
+      int id = astar::idx(n.x, n.y, w);
+      if (closed_[id] == gen_) continue;
+      closed_[id] = gen_;
+      if (n.x == goal.x && n.y == goal.y) { found = true; break; }
+
+      int dirs[8][2]; int nd = 0;
+      successors(n.x, n.y, came_[id], w, dirs, nd);
+      for (int k = 0; k < nd; ++k) {
+        Vec2i j;
+        if (!jump(n.x, n.y, dirs[k][0], dirs[k][1], j)) continue;
+        int nid = astar::idx(j.x, j.y, w);
+        touch(nid);
+        int steps = std::max(std::abs(j.x - n.x), std::abs(j.y - n.y));
+        float step = (dirs[k][0] && dirs[k][1]) ? std::sqrt(2.f) : 1.f;
+        float tentative = g_[id] + float(steps) * step;
+        if (tentative < g_[nid]) {
+          g_[nid] = tentative;
+          came_[nid] = id;
+          push({j.x, j.y, tentative + astar::heuristic(j.x, j.y, goal.x, goal.y)});
+        }
+      }
+    }
+
+    if (!found) return false;
+
+    // Reconstruct jump points, then fill in the straight/diagonal runs between them
+    int cur = t;
+    while (cur != -1) {
+      out.push_back({cur % w, cur / w});
+      if (cur == s) break;
+      cur = came_[cur];
+    }
+    std::reverse(out.begin(), out.end());
+    expand(out);
+    return true;
+  }
+
+private:
+  astar::CancelFlag cancel_;
+  int mw_ = -1, mh_ = -1;
+  MapVersion synced_; // map version the bitsets were last synced to
+  std::vector<DirtyRect> dirty_;
+  LineBits rows_, cols_;
+  Vec2i goal_;
+  int w_ = 0, h_ = 0;
+  uint32_t gen_ = 0;
+  std::vector<uint32_t> seen_;
+  std::vector<uint32_t> closed_;
+  std::vector<float> g_;
+  std::vector<int> came_;
+  std::vector<astar::Node> open_;
+
+  bool blocked(int x, int y) const { return rows_.get(y, x); }
+
+  // Pruned neighbor directions of (x, y) given the parent it was reached from.
+  void successors(int x, int y, int parent, int w, int (&dirs)[8][2], int& nd) const {
+    auto add = [&](int dx, int dy) { dirs[nd][0] = dx; dirs[nd][1] = dy; ++nd; };
+    if (parent < 0) {
+      for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx)
+          if (dx || dy) add(dx, dy);
+      return;
+    }
+    int px = parent % w, py = parent / w;
+    int dx = (x > px) - (x < px);
+    int dy = (y > py) - (y < py);
+    if (dx && dy) {
+      add(dx, dy); add(dx, 0); add(0, dy);
+      if (blocked(x - dx, y)) add(-dx, dy);
+      if (blocked(x, y - dy)) add(dx, -dy);
+    } else if (dx) {
+      add(dx, 0);
+      if (blocked(x, y + 1)) add(dx, 1);
+      if (blocked(x, y - 1)) add(dx, -1);
+    } else {
+      add(0, dy);
+      if (blocked(x + 1, y)) add(1, dy);
+      if (blocked(x - 1, y)) add(-1, dy);
+    }
+  }
+
+  bool jumpStraight(int x, int y, int dx, int dy) const {
+    if (dx) return rows_.scan(y, x, dx, goal_.y == y ? goal_.x : -1) != -2;
+    return cols_.scan(x, y, dy, goal_.x == x ? goal_.y : -1) != -2;
+  }
+
+  bool jump(int x, int y, int dx, int dy, Vec2i& out) const {
+    if (!dy) {
+      int c = rows_.scan(y, x, dx, goal_.y == y ? goal_.x : -1);
+      if (c == -2) return false;
+      out = {c, y}; return true;
+    }
+    if (!dx) {
+      int c = cols_.scan(x, y, dy, goal_.x == x ? goal_.y : -1);
+      if (c == -2) return false;
+      out = {x, c}; return true;
+    }
+    for (;;) {
+      x += dx; y += dy;
+      if (blocked(x, y)) return false;
+      if (x == goal_.x && y == goal_.y) { out = {x, y}; return true; }
+      bool forced = (blocked(x - dx, y) && !blocked(x - dx, y + dy)) ||
+                    (blocked(x, y - dy) && !blocked(x + dx, y - dy));
+      if (forced || jumpStraight(x, y, dx, 0) || jumpStraight(x, y, 0, dy)) {
+        out = {x, y}; return true;
+      }
+    }
+  }
+
+  static void expand(std::vector<Vec2i>& pts) {
+    if (pts.size() < 2) return;
+    std::vector<Vec2i> full;
+    full.push_back(pts.front());
+    for (size_t i = 1; i < pts.size(); ++i) {
+      Vec2i a = pts[i - 1], b = pts[i];
+      int dx = (b.x > a.x) - (b.x < a.x);
+      int dy = (b.y > a.y) - (b.y < a.y);
+      while (a != b) { a.x += dx; a.y += dy; full.push_back(a); }
+    }
+    pts.swap(full);
+  }
+
+  void prepare(int w, int h) {
+    if (w != w_ || h != h_) {
+      w_ = w; h_ = h;
+      seen_.assign(size_t(w) * h, 0);
+      closed_.assign(size_t(w) * h, 0);
+      g_.resize(size_t(w) * h);
+      came_.resize(size_t(w) * h);
+      gen_ = 0;
+    }
+    if (++gen_ == 0) {
+      std::fill(seen_.begin(), seen_.end(), 0u);
+      std::fill(closed_.begin(), closed_.end(), 0u);
+      gen_ = 1;
+    }
+    open_.clear();
+  }
+
+  void touch(int id) {
+    if (seen_[id] == gen_) return;
+    seen_[id] = gen_;
+    g_[id] = std::numeric_limits<float>::infinity();
+    came_[id] = -1;
+  }
+
+  void push(astar::Node n) { open_.push_back(n); std::push_heap(open_.begin(), open_.end()); }
+  astar::Node pop() { std::pop_heap(open_.begin(), open_.end()); astar::Node n = open_.back(); open_.pop_back(); return n; }
+};
+
+} // namespace jps
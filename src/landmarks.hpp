@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "a_star.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+#include "open_list.hpp"
+#include "profiler.hpp"
+
+// ALT (A*, landmarks, triangle inequality) preprocessing for static maps.
+// Landmarks stores the exact 8-connected path cost from a few landmark cells
+// to every cell; for any landmark L the triangle inequality gives
+// d(v, t) >= |d(L, t) - d(L, v)|, and the largest of these bounds is an
+// admissible, consistent heuristic that sees walls the Euclidean one ignores.
+// Landmarks are picked greedily on the map's periphery: each new one is the
+// reachable cell farthest from those chosen so far. alt::View wraps a grid
+// and exposes the bound through the planners' optional `heuristic` hook.
+//
+// The tables cost 4 bytes per cell per landmark and are laid out cell-major,
+// so one lookup reads a single cache line. They are only valid for the exact
+// occupancy they were built from; save()/load() key them on a hash of
+// GridMap::occ and loadOrBuild() keeps a cache directory of them.
+//
+// File format (little-endian):
+//   char[4] "PPLM", u32 version, i32 w, i32 h, u32 count, u64 occ hash,
+//   count * (i32 x, i32 y), then w * h * count float distances (cell-major)
+namespace alt {
+
+// FNV-1a over the map size and occupancy.
+inline uint64_t hashMap(const GridMap& map) {
+  uint64_t hash = 1469598103934665603ull;
+  auto mix = [&](uint8_t b) { hash = (hash ^ b) * 1099511628211ull; };
+  for (int v : {map.w, map.h})
+    for (int i = 0; i < 4; ++i) mix(uint8_t(uint32_t(v) >> (8 * i)));
+  for (uint8_t c : map.occ) mix(c ? 1 : 0);
+  return hash;
+}
+
+class Landmarks {
+public:
+  static constexpr float kInf = std::numeric_limits<float>::infinity();
+
+  int count() const { return int(points_.size()); }
+  int width() const { return w_; }
+  int height() const { return h_; }
+  uint64_t mapHash() const { return hash_; }
+  const std::vector<Vec2i>& points() const { return points_; }
+
+  // True if the tables were built for exactly this occupancy.
+  bool matches(const GridMap& map) const {
+    return !points_.empty() && map.w == w_ && map.h == h_ && hashMap(map) == hash_;
+  }
+
+  // Path cost from landmark l to cell id (infinity if unreachable).
+  float distance(int l, int id) const { return dist_[size_t(id) * points_.size() + size_t(l)]; }
+
+  // Lower bound on the path cost between cells a and b (0 without tables).
+  float bound(int a, int b) const {
+    const size_t n = points_.size();
+    const float* da = &dist_[size_t(a) * n];
+    const float* db = &dist_[size_t(b) * n];
+    float best = 0.f;
+    for (size_t l = 0; l < n; ++l) {
+      const float d = std::fabs(da[l] - db[l]);
+      if (d < kInf) best = std::max(best, d); // skips landmarks that cannot reach both
+    }
+    return best;
+  }
+
+  // Pick `count` landmarks and compute their tables (one Dijkstra each).
+  // Returns false if the map has no free cell.
+  bool build(const GridMap& map, int count = 8) {
+    PP_PROF_SCOPE("alt.build");
+    clear();
+    const size_t n = size_t(map.w) * size_t(map.h);
+    int seed = -1;
+    // Start from the free cell nearest the centre; its farthest cell is the first landmark
+    long long bestD2 = -1;
+    for (int y = 0; y < map.h; ++y)
+      for (int x = 0; x < map.w; ++x) {
+        if (!map.isFree(x, y)) continue;
+        const long long dx = 2 * x - map.w, dy = 2 * y - map.h, d2 = dx * dx + dy * dy;
+        if (bestD2 < 0 || d2 < bestD2) { bestD2 = d2; seed = astar::idx(x, y, map.w); }
+      }
+    if (seed < 0) return false;
+    w_ = map.w; h_ = map.h;
+    hash_ = hashMap(map);
+
+    std::vector<float> d, nearest(n, kInf);
+    dijkstra(map, seed, d);
+    int next = farthest(d);
+    count = std::max(1, count);
+    std::vector<std::vector<float>> tables;
+    while (int(points_.size()) < count && next >= 0) {
+      points_.push_back({next % w_, next / w_});
+      dijkstra(map, next, d);
+      for (size_t i = 0; i < n; ++i) nearest[i] = std::min(nearest[i], d[i]);
+      tables.push_back(d);
+      next = farthest(nearest);
+      if (next >= 0 && nearest[size_t(next)] <= 0.f) next = -1; // every reachable cell is a landmark
+    }
+    const size_t L = points_.size();
+    dist_.resize(n * L);
+    for (size_t l = 0; l < L; ++l)
+      for (size_t i = 0; i < n; ++i) dist_[i * L + l] = tables[l][i];
+    return true;
+  }
+
+  bool save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) { std::cerr << "Failed to open landmark file '" << path << "' for writing\n"; return false; }
+    out.write("PPLM", 4);
+    put(out, kVersion);
+    put(out, int32_t(w_)); put(out, int32_t(h_));
+    put(out, uint32_t(points_.size()));
+    put(out, hash_);
+    for (const Vec2i& p : points_) { put(out, int32_t(p.x)); put(out, int32_t(p.y)); }
+    out.write(reinterpret_cast<const char*>(dist_.data()), std::streamsize(dist_.size() * sizeof(float)));
+    if (!out) { std::cerr << "Failed to write landmark file '" << path << "'\n"; return false; }
+    return true;
+  }
+
+  // Load tables saved for exactly `map`. Returns false (and keeps the
+  // current tables) if the file is missing, malformed or for another map.
+  bool load(const std::string& path, const GridMap& map) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    int32_t w = 0, h = 0;
+    uint64_t hash = 0;
+    in.read(magic, 4);
+    get(in, version); get(in, w); get(in, h); get(in, count); get(in, hash);
+    if (!in || std::memcmp(magic, "PPLM", 4) != 0) { std::cerr << "Not a landmark file: '" << path << "'\n"; return false; }
+    if (version != kVersion) { std::cerr << "Unsupported landmark file version " << version << "\n"; return false; }
+    if (w != map.w || h != map.h || hash != hashMap(map) || count == 0) return false;
+    std::vector<Vec2i> points(count);
+    for (Vec2i& p : points) {
+      int32_t x = 0, y = 0;
+      get(in, x); get(in, y);
+      p = {x, y};
+    }
+    std::vector<float> dist(size_t(w) * size_t(h) * count);
+    in.read(reinterpret_cast<char*>(dist.data()), std::streamsize(dist.size() * sizeof(float)));
+    if (!in) { std::cerr << "Truncated landmark file '" << path << "'\n"; return false; }
+    w_ = w; h_ = h; hash_ = hash;
+    points_.swap(points);
+    dist_.swap(dist);
+    return true;
+  }
+
+  // Cache file for `map` with `count` landmarks inside `dir`.
+  static std::string cachePath(const std::string& dir, const GridMap& map, int count) {
+    char name[64];
+    std::snprintf(name, sizeof name, "landmarks_%016llx_%d.bin", (unsigned long long)hashMap(map), count);
+    return (std::filesystem::path(dir) / name).string();
+  }
+
+  // Load the tables for `map` from `dir`, or build them and store them
+  // there. *cached tells which happened. A failed write only warns.
+  bool loadOrBuild(const GridMap& map, int count, const std::string& dir, bool* cached = nullptr) {
+    const std::string path = cachePath(dir, map, count);
+    const bool hit = load(path, map);
+    if (cached) *cached = hit;
+    if (hit) return true;
+    if (!build(map, count)) return false;
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    const std::string tmp = path + ".tmp"; // readers never see a partial file
+    if (save(tmp)) {
+      std::filesystem::rename(tmp, path, ec);
+      if (ec) std::cerr << "Failed to store landmark cache '" << path << "': " << ec.message() << "\n";
+    }
+    return true;
+  }
+
+  void clear() {
+    points_.clear();
+    dist_.clear();
+    w_ = h_ = 0;
+    hash_ = 0;
+  }
+
+private:
+  static constexpr uint32_t kVersion = 1;
+  int w_ = 0, h_ = 0;
+  uint64_t hash_ = 0;
+  std::vector<Vec2i> points_;
+  std::vector<float> dist_; // cell-major: dist_[cell * count + landmark]
+  astar::IndexedHeap4 open_;
+  std::vector<uint8_t> closed_;
+
+  template <class T> static void put(std::ofstream& out, const T& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+  template <class T> static void get(std::ifstream& in, T& v) { in.read(reinterpret_cast<char*>(&v), sizeof(T)); }
+
+  // Reachable cell with the largest finite value of d, or -1.
+  static int farthest(const std::vector<float>& d) {
+    int best = -1;
+    for (size_t i = 0; i < d.size(); ++i)
+      if (d[i] < kInf && (best < 0 || d[i] > d[size_t(best)])) best = int(i);
+    return best;
+  }
+
+  // Path costs from `source` with the planners' moves and step lengths.
+  void dijkstra(const GridMap& map, int source, std::vector<float>& d) {
+    const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    const float cost[8] = {1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f)};
+    const int w = map.w;
+    const size_t n = size_t(w) * size_t(map.h);
+    d.assign(n, kInf);
+    closed_.assign(n, 0);
+    open_.reset(n);
+    open_.clear();
+    d[size_t(source)] = 0.f;
+    open_.push(source, 0.f);
+    while (!open_.empty()) {
+      const int id = open_.pop();
+      if (closed_[size_t(id)]) continue;
+      closed_[size_t(id)] = 1;
+      const int cx = id % w, cy = id / w;
+      const unsigned freeDirs = map.freeMask(cx, cy);
+      for (int k = 0; k < 8; ++k) {
+        if (!((freeDirs >> k) & 1u)) continue;
+        const int nid = astar::idx(cx + dx[k], cy + dy[k], w);
+        const float g = d[size_t(id)] + cost[k];
+        if (g < d[size_t(nid)]) {
+          d[size_t(nid)] = g;
+          open_.push(nid, g);
+        }
+      }
+    }
+  }
+};
+
+// Grid view that adds the landmark bound as `heuristic` for astar::Planner
+// (and forwards cellCost when the wrapped grid has one, so it also wraps a
+// costmap::Costmap, whose costs only exceed the plain ones). With no tables,
+// or tables of another size, it falls back to the Euclidean heuristic. It
+// cannot tell that same-size tables are stale: after any edit the caller
+// must rebuild them (plan_batch does, before the next query), or the bound
+// may overestimate and paths come back longer than the shortest.
+template <class Grid>
+class View {
+public:
+  int w = 0, h = 0;
+
+  View(const Grid& grid, const Landmarks& lm)
+      : w(grid.w), h(grid.h), grid_(grid), lm_(lm),
+        active_(lm.count() > 0 && lm.width() == grid.w && lm.height() == grid.h) {}
+
+  bool inBounds(int x, int y) const { return grid_.inBounds(x, y); }
+  bool isFree(int x, int y) const { return grid_.isFree(x, y); }
+  auto freeMask(int x, int y) const { return grid_.freeMask(x, y); }
+
+  template <class G = Grid>
+  auto cellCost(int x, int y) const -> decltype(std::declval<const G&>().cellCost(x, y)) {
+    return grid_.cellCost(x, y);
+  }
+
+  float heuristic(int x, int y, int gx, int gy) const {
+    const float e = astar::heuristic(x, y, gx, gy);
+    return active_ ? std::max(e, lm_.bound(astar::idx(x, y, w), astar::idx(gx, gy, w))) : e;
+  }
+
+private:
+  const Grid& grid_;
+  const Landmarks& lm_;
+  bool active_;
+};
+
+} // namespace alt
@@ -0,0 +1,421 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "a_star.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+#include "open_list.hpp"
+#include "profiler.hpp"
+#include "static_astar.hpp"
+
+// State-lattice planner for car-like robots: A* over (cell, heading) states
+// connected by motion primitives that respect a minimum turning radius, so
+// the path it returns can be driven as is.
+//
+// There are 16 headings, along the grid vectors (1,0), (2,1), (1,1), (1,2)
+// and their rotations, so every primitive starts and ends on a cell centre.
+// For each heading there is one straight primitive and a turn to each
+// neighbouring heading. A turn is a straight segment then an arc, or an arc
+// then a straight segment, with radius >= the turning radius; the shortest
+// one that ends exactly on a cell is kept. The same motions driven backwards
+// (at a higher cost) let the robot back out of dead ends, which forward-only
+// motion cannot leave. Primitives::build() samples each
+// primitive once and stores the cells its footprint (a disc) sweeps as
+// offsets from the start cell, so collision checking at query time is a walk
+// over a small table of occupancy lookups. The tables are built when the
+// planner is created or the radius changes and take a few kilobytes.
+//
+// The heuristic is the exact obstacle-aware 8-connected distance to the
+// goal (astar::ReverseDistance), which runs a little longer than the lattice's
+// 16-direction motions along (2,1) headings: paths cost at most 8% more than
+// the cheapest in the lattice and in practice within about 1%. With
+// setAdmissible(true) it is scaled by sqrt(5) / (1 + sqrt(2)) so paths are
+// the cheapest, at several times the expansions. Turns cost `turnPenalty`
+// more per unit length than straight motion. Workspaces are generation
+// stamped like astar::Planner's, 12 bytes per (cell, heading) state (about
+// 50 MB for a 512x512 map). State ids must fit the open list's int, so maps
+// over kMaxCells cells (about 11585x11585) are rejected: plan() returns false.
+namespace lattice {
+
+constexpr int kHeadings = 16;
+constexpr size_t kMaxCells = size_t(std::numeric_limits<int32_t>::max()) / kHeadings;
+constexpr float kTwoPi = 6.28318531f;
+
+// Grid vector of heading k (y down, like the map).
+inline Vec2i headingDir(int k) {
+  static const int dx[kHeadings] = {1, 2, 1, 1, 0, -1, -1, -2, -1, -2, -1, -1, 0, 1, 1, 2};
+  static const int dy[kHeadings] = {0, 1, 1, 2, 1, 2, 1, 1, 0, -1, -1, -2, -1, -2, -1, -1};
+  return {dx[k & (kHeadings - 1)], dy[k & (kHeadings - 1)]};
+}
+
+inline float headingAngle(int k) {
+  const Vec2i d = headingDir(k);
+  return std::atan2(float(d.y), float(d.x));
+}
+
+// Heading whose angle is closest to theta (radians).
+inline int headingIndex(float theta) {
+  int best = 0;
+  float bestErr = 10.f;
+  for (int k = 0; k < kHeadings; ++k) {
+    const float err = std::fabs(std::remainder(theta - headingAngle(k), kTwoPi));
+    if (err < bestErr) { bestErr = err; best = k; }
+  }
+  return best;
+}
+
+class Primitives {
+public:
+  struct Offset { int16_t dx, dy; };
+  struct Sample { float x, y, theta; }; // relative to the start cell centre; theta: direction of travel
+
+  struct Motion {
+    int16_t dx, dy;          // end cell relative to the start cell
+    uint8_t from, to;        // headings
+    bool reverse;            // driven backwards
+    float length, cost;
+    uint32_t cellBegin, cellEnd;     // swept cells in cells()
+    uint32_t sampleBegin, sampleEnd; // poses along the motion in samples(), end included
+    int16_t minDx, maxDx, minDy, maxDy; // bounding box of the swept cells
+  };
+
+  float turnRadius() const { return radius_; }
+  float footprintRadius() const { return footprint_; }
+  float turnPenalty() const { return turnPenalty_; }
+  float reversePenalty() const { return reversePenalty_; }
+  size_t size() const { return motions_.size(); }
+
+  const Motion* begin(int heading) const { return motions_.data() + first_[heading]; }
+  const Motion* end(int heading) const { return motions_.data() + first_[heading + 1]; }
+  const std::vector<Offset>& cells() const { return cells_; }
+  const std::vector<Sample>& samples() const { return samples_; }
+
+  // Generate the primitives for a minimum turning radius (cells), a disc
+  // footprint of the given radius and the extra relative cost of turning.
+  // Unless reversePenalty is negative, each heading also gets the forward
+  // motions of the opposite heading driven backwards, costing
+  // 1 + reversePenalty times as much.
+  void build(float turnRadius, float footprintRadius = 0.4f, float turnPenalty = 0.1f, float reversePenalty = 1.f) {
+    radius_ = std::max(0.5f, turnRadius);
+    footprint_ = std::max(0.f, footprintRadius);
+    turnPenalty_ = turnPenalty;
+    reversePenalty_ = reversePenalty;
+    motions_.clear(); cells_.clear(); samples_.clear();
+    std::vector<Motion> forward;
+    uint32_t range[kHeadings + 1];
+    for (int k = 0; k < kHeadings; ++k) {
+      range[k] = uint32_t(forward.size());
+      const Vec2i d = headingDir(k);
+      const float a = headingAngle(k);
+      const float len = std::sqrt(float(d.x * d.x + d.y * d.y));
+      forward.push_back(add(k, k, d, len, len, 0.f, 0.f, a));
+      for (int turn : {-1, 1}) {
+        const int to = (k + turn + kHeadings) & (kHeadings - 1);
+        Turn best;
+        findTurn(k, to, best);
+        if (best.length > 0.f)
+          forward.push_back(add(k, to, best.end, best.length, best.length * (1.f + turnPenalty), best.before, best.arcRadius, a));
+      }
+    }
+    range[kHeadings] = uint32_t(forward.size());
+    // Backing up with heading k traces a forward motion of heading k + 8;
+    // it sweeps the same cells and passes the same positions.
+    for (int k = 0; k < kHeadings; ++k) {
+      first_[k] = uint32_t(motions_.size());
+      motions_.insert(motions_.end(), forward.begin() + range[k], forward.begin() + range[k + 1]);
+      if (reversePenalty < 0.f) continue;
+      const int opposite = (k + kHeadings / 2) & (kHeadings - 1);
+      for (uint32_t i = range[opposite]; i < range[opposite + 1]; ++i) {
+        Motion m = forward[i];
+        m.from = uint8_t(k);
+        m.to = uint8_t((m.to + kHeadings / 2) & (kHeadings - 1));
+        m.cost *= 1.f + reversePenalty;
+        m.reverse = true;
+        motions_.push_back(m);
+      }
+    }
+    first_[kHeadings] = uint32_t(motions_.size());
+  }
+
+private:
+  struct Turn {
+    Vec2i end{0, 0};
+    float length = 0.f, before = 0.f, arcRadius = 0.f; // before: straight part ahead of the arc
+  };
+
+  float radius_ = 0.f, footprint_ = 0.f, turnPenalty_ = 0.f, reversePenalty_ = 0.f;
+  uint32_t first_[kHeadings + 1] = {};
+  std::vector<Motion> motions_;
+  std::vector<Offset> cells_;
+  std::vector<Sample> samples_;
+
+  // Shortest straight+arc or arc+straight from heading `from` to `to` that
+  // ends on a cell centre, with arc radius >= radius_.
+  void findTurn(int from, int to, Turn& best) const {
+    const float t0 = headingAngle(from), t1 = headingAngle(to);
+    const float delta = std::remainder(t1 - t0, kTwoPi);
+    const float s = delta > 0.f ? 1.f : -1.f;
+    const float ux0 = std::cos(t0), uy0 = std::sin(t0), ux1 = std::cos(t1), uy1 = std::sin(t1);
+    // An arc of radius r moves the robot by r * (cx, cy)
+    const float cx = s * (uy1 - uy0), cy = s * (ux0 - ux1);
+    const int reach = int(std::ceil(2.f * radius_)) + 4;
+    for (int py = -reach; py <= reach; ++py)
+      for (int px = -reach; px <= reach; ++px) {
+        for (int arcFirst = 0; arcFirst < 2; ++arcFirst) {
+          // p = a * u + r * c with u the heading of the straight part
+          const float ux = arcFirst ? ux1 : ux0, uy = arcFirst ? uy1 : uy0;
+          const float det = ux * cy - uy * cx;
+          if (std::fabs(det) < 1e-6f) continue;
+          const float a = (float(px) * cy - float(py) * cx) / det;
+          const float r = (ux * float(py) - uy * float(px)) / det;
+          if (a < -1e-4f || r < radius_ - 1e-4f) continue;
+          const float length = std::max(0.f, a) + r * std::fabs(delta);
+          if (best.length == 0.f || length < best.length - 1e-4f) {
+            best.end = {px, py};
+            best.length = length;
+            best.before = arcFirst ? -std::max(0.f, a) : std::max(0.f, a); // negative: straight after the arc
+            best.arcRadius = r;
+          }
+        }
+      }
+  }
+
+  // Pose after travelling `t` along a motion: straight `before` (or after,
+  // if negative), then an arc of radius r from heading angle a0.
+  static Sample poseAt(float t, float before, float r, float a0, float delta, float total) {
+    const float straight = std::fabs(before), arc = total - straight;
+    const float s = delta > 0.f ? 1.f : (delta < 0.f ? -1.f : 0.f);
+    auto arcPose = [&](float x0, float y0, float u) { // u: distance along the arc
+      if (s == 0.f || r <= 0.f) return Sample{x0 + u * std::cos(a0), y0 + u * std::sin(a0), a0};
+      const float phi = a0 + s * u / r;
+      // centre on the turning side
+      const float ccx = x0 - s * r * std::sin(a0), ccy = y0 + s * r * std::cos(a0);
+      return Sample{ccx + s * r * std::sin(phi), ccy - s * r * std::cos(phi), phi};
+    };
+    if (before >= 0.f) {
+      if (t <= straight) return {t * std::cos(a0), t * std::sin(a0), a0};
+      return arcPose(straight * std::cos(a0), straight * std::sin(a0), t - straight);
+    }
+    if (t <= arc) return arcPose(0.f, 0.f, t);
+    const Sample e = arcPose(0.f, 0.f, arc);
+    return {e.x + (t - arc) * std::cos(e.theta), e.y + (t - arc) * std::sin(e.theta), e.theta};
+  }
+
+  Motion add(int from, int to, Vec2i end, float length, float cost, float before, float r, float a0) {
+    const float delta = std::remainder(headingAngle(to) - a0, kTwoPi);
+    Motion m{};
+    m.dx = int16_t(end.x); m.dy = int16_t(end.y);
+    m.from = uint8_t(from); m.to = uint8_t(to);
+    m.length = length; m.cost = cost;
+    m.cellBegin = uint32_t(cells_.size());
+    m.sampleBegin = uint32_t(samples_.size());
+
+    // Footprint: cells within footprint_ of the centre line, sampled finely
+    std::vector<Offset> swept;
+    const int fine = std::max(2, int(std::ceil(length / 0.05f)));
+    const int reach = int(std::ceil(footprint_ + 0.5f));
+    for (int i = 0; i <= fine; ++i) {
+      Sample p = poseAt(length * float(i) / float(fine), before, r, a0, delta, length);
+      if (i == fine) p = {float(end.x), float(end.y), headingAngle(to)}; // exact end pose
+      const int ix = int(std::lround(p.x)), iy = int(std::lround(p.y));
+      for (int oy = -reach; oy <= reach; ++oy)
+        for (int ox = -reach; ox <= reach; ++ox) {
+          // distance from p to the square of cell (ix + ox, iy + oy)
+          const float qx = std::max(0.f, std::fabs(p.x - float(ix + ox)) - 0.5f);
+          const float qy = std::max(0.f, std::fabs(p.y - float(iy + oy)) - 0.5f);
+          if (qx * qx + qy * qy < footprint_ * footprint_ || (ox == 0 && oy == 0))
+            swept.push_back({int16_t(ix + ox), int16_t(iy + oy)});
+        }
+    }
+    std::sort(swept.begin(), swept.end(), [](Offset a, Offset b) { return a.dy != b.dy ? a.dy < b.dy : a.dx < b.dx; });
+    swept.erase(std::unique(swept.begin(), swept.end(), [](Offset a, Offset b) { return a.dx == b.dx && a.dy == b.dy; }), swept.end());
+    m.minDx = m.maxDx = swept[0].dx;
+    m.minDy = m.maxDy = swept[0].dy;
+    for (const Offset& o : swept) {
+      m.minDx = std::min(m.minDx, o.dx); m.maxDx = std::max(m.maxDx, o.dx);
+      m.minDy = std::min(m.minDy, o.dy); m.maxDy = std::max(m.maxDy, o.dy);
+    }
+    cells_.insert(cells_.end(), swept.begin(), swept.end());
+    m.cellEnd = uint32_t(cells_.size());
+
+    // Output poses roughly every half cell, excluding the start pose
+    const int coarse = std::max(1, int(std::ceil(length / 0.5f)));
+    for (int i = 1; i <= coarse; ++i) {
+      Sample p = poseAt(length * float(i) / float(coarse), before, r, a0, delta, length);
+      if (i == coarse) p = {float(end.x), float(end.y), headingAngle(to)};
+      samples_.push_back(p);
+    }
+    m.sampleEnd = uint32_t(samples_.size());
+    return m;
+  }
+};
+
+class Planner {
+public:
+  explicit Planner(float turnRadius = 3.f, float footprintRadius = 0.4f, float turnPenalty = 0.1f, float reversePenalty = 1.f) {
+    prims_.build(turnRadius, footprintRadius, turnPenalty, reversePenalty);
+  }
+
+  void setTurnRadius(float r) {
+    prims_.build(r, prims_.footprintRadius(), prims_.turnPenalty(), prims_.reversePenalty());
+    w_ = -1; // footprint offsets are rebuilt on the next query
+  }
+  const Primitives& primitives() const { return prims_; }
+  // Trade speed for the cheapest path in the lattice (see above).
+  void setAdmissible(bool on) { scale_ = on ? kAdmissibleScale : 1.f; }
+
+  // While *flag is true, plan() abandons its search and returns false.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; heuristic_.setCancelFlag(flag); }
+
+  long long lastExpanded() const { return expanded_; }
+  // Length of the last path found, in cells.
+  float lastLength() const { return length_; }
+  // Cells at the ends of the motions of the last path, start first.
+  const std::vector<Vec2i>& lastCells() const { return cells_; }
+
+  // Plan from the centre of `start` facing startHeading (radians) to the
+  // centre of `goal`, with any final heading unless goalHeading >= 0 (an
+  // index, see headingIndex). `out` receives poses along the path (cell
+  // centres at x + 0.5, y + 0.5), start first; false if none exists.
+  bool plan(const GridMap& map, Vec2i start, float startHeading, Vec2i goal, std::vector<Vec2f>& out, int goalHeading = -1) {
+    PP_PROF_SCOPE("lattice.plan");
+    bool found = search(map, start, headingIndex(startHeading), goal, goalHeading, out);
+    PP_PROF_COUNT("lattice.expanded", expanded_);
+    return found;
+  }
+
+private:
+  // Length of a (2,1) motion over the 8-connected distance it spans
+  static constexpr float kAdmissibleScale = 0.9262096f; // sqrt(5) / (1 + sqrt(2))
+  static constexpr float kInf = std::numeric_limits<float>::infinity();
+
+  Primitives prims_;
+  astar::ReverseDistance<astar::Connect8, astar::Octile> heuristic_;
+  float scale_ = 1.f;
+  astar::CancelFlag cancel_;
+  astar::LazyHeap open_;       // lazy: 8 bytes per entry, nothing per state
+  long long expanded_ = 0;
+  float length_ = 0.f;
+  std::vector<Vec2i> cells_;
+  int w_ = -1, h_ = -1;
+  uint32_t gen_ = 0;
+  std::vector<uint32_t> seen_;   // (generation << 1) | closed
+  std::vector<float> g_;
+  std::vector<uint32_t> came_;   // parent state
+  std::vector<int32_t> linear_;  // cells() offsets as index deltas for width w_
+
+  float h(int x, int y, Vec2i goal) {
+    const float d = heuristic_.distance(x, y);
+    return d == kInf ? kInf : std::max(astar::heuristic(x, y, goal.x, goal.y), scale_ * d);
+  }
+
+  // True if motion m from cell (x, y) only sweeps free cells.
+  bool clear(const GridMap& map, int x, int y, const Primitives::Motion& m) const {
+    if (x + m.minDx < 0 || y + m.minDy < 0 || x + m.maxDx >= map.w || y + m.maxDy >= map.h) return false;
+    const uint8_t* occ = map.occ.data() + astar::idx(x, y, map.w);
+    for (uint32_t i = m.cellBegin; i < m.cellEnd; ++i)
+      if (occ[linear_[i]]) return false;
+    return true;
+  }
+
+  void prepare(const GridMap& map) {
+    const size_t states = size_t(map.w) * size_t(map.h) * kHeadings;
+    if (map.w != w_ || map.h != h_) {
+      w_ = map.w; h_ = map.h;
+      seen_.assign(states, 0);
+      g_.resize(states);
+      came_.resize(states);
+      open_.reset(states);
+      gen_ = 0;
+      linear_.clear();
+      for (const Primitives::Offset& o : prims_.cells()) linear_.push_back(int32_t(o.dy) * w_ + o.dx);
+    }
+    if (++gen_ >= (1u << 31)) { // stamp wrap-around
+      std::fill(seen_.begin(), seen_.end(), 0u);
+      gen_ = 1;
+    }
+    open_.clear();
+  }
+
+  bool search(const GridMap& map, Vec2i start, int k0, Vec2i goal, int goalHeading, std::vector<Vec2f>& out) {
+    out.clear();
+    cells_.clear();
+    expanded_ = 0;
+    length_ = 0.f;
+    if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return false;
+    if (!map.isFree(start.x, start.y) || !map.isFree(goal.x, goal.y)) return false;
+    if (size_t(map.w) * size_t(map.h) > kMaxCells) return false;
+    heuristic_.start(map, goal, start);
+    if (h(start.x, start.y, goal) == kInf) return false;
+    prepare(map);
+
+    const uint32_t open = gen_ << 1, closed = open | 1u;
+    const uint32_t s = uint32_t(astar::idx(start.x, start.y, w_)) * kHeadings + uint32_t(k0);
+    seen_[s] = open;
+    g_[s] = 0.f;
+    came_[s] = s;
+    open_.push(int(s), h(start.x, start.y, goal));
+
+    uint32_t found = UINT32_MAX;
+    while (!open_.empty()) {
+      if (cancel_.poll()) return false;
+      const uint32_t id = uint32_t(open_.pop());
+      if (seen_[id] == closed) continue; // stale entry
+      seen_[id] = closed;
+      ++expanded_;
+      const int k = int(id % kHeadings), cell = int(id / kHeadings);
+      const int x = cell % w_, y = cell / w_;
+      if (x == goal.x && y == goal.y && (goalHeading < 0 || goalHeading == k)) { found = id; break; }
+
+      for (const Primitives::Motion* m = prims_.begin(k); m != prims_.end(k); ++m) {
+        if (!clear(map, x, y, *m)) continue;
+        const int nx = x + m->dx, ny = y + m->dy;
+        const uint32_t nid = uint32_t(astar::idx(nx, ny, w_)) * kHeadings + m->to;
+        if (seen_[nid] == closed) continue;
+        const float tentative = g_[id] + m->cost;
+        if (seen_[nid] == open && !(tentative < g_[nid])) continue;
+        const float hn = h(nx, ny, goal);
+        if (hn == kInf) continue;
+        seen_[nid] = open;
+        g_[nid] = tentative;
+        came_[nid] = id;
+        open_.push(int(nid), tentative + hn);
+      }
+    }
+    if (found == UINT32_MAX) return false;
+
+    // Walk back to the start, then emit each motion's poses
+    std::vector<uint32_t> states;
+    for (uint32_t cur = found;; cur = came_[cur]) {
+      states.push_back(cur);
+      if (cur == s) break;
+    }
+    std::reverse(states.begin(), states.end());
+    out.push_back({start.x + 0.5f, start.y + 0.5f});
+    cells_.push_back(start);
+    for (size_t i = 1; i < states.size(); ++i) {
+      const int pk = int(states[i - 1] % kHeadings), pc = int(states[i - 1] / kHeadings);
+      const int px = pc % w_, py = pc / w_;
+      const int cc = int(states[i] / kHeadings);
+      const int k = int(states[i] % kHeadings);
+      for (const Primitives::Motion* m = prims_.begin(pk); m != prims_.end(pk); ++m) {
+        if (m->to != k || px + m->dx != cc % w_ || py + m->dy != cc / w_) continue;
+        for (uint32_t j = m->sampleBegin; j < m->sampleEnd; ++j) {
+          const Primitives::Sample& p = prims_.samples()[j];
+          out.push_back({px + 0.5f + p.x, py + 0.5f + p.y});
+        }
+        length_ += m->length;
+        break;
+      }
+      cells_.push_back({cc % w_, cc / w_});
+    }
+    return true;
+  }
+};
+
+} // namespace lattice
@@ -1,23 +1,54 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/System.hpp>
 #include <SFML/Config.hpp>
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 
 #include "a_star.hpp"
+#include "bidir.hpp"
 #include "controller.hpp"
+#include "dstar_lite.hpp"
+#include "flow_field.hpp"
+#include "hpa.hpp"
+#include "jps.hpp"
+#include "lattice.hpp"
 #include "map.hpp"
+#include "map_sfml.hpp"
+#include "path_post.hpp"
+#include "plan_worker.hpp"
+#include "profiler.hpp"
+#include "theta_star.hpp"
+#include "telemetry.hpp"
 
 using Clock = std::chrono::high_resolution_clock;
 
+enum class Engine { AStar, JPS, DStarLite, HPA, Theta, Bidir, Flow, Lattice, Count };
+
+static const char* engineName(Engine e) {
+  switch (e) {
+    case Engine::AStar: return "A*";
+    case Engine::JPS: return "Jump Point Search";
+    case Engine::DStarLite: return "D* Lite (incremental)";
+    case Engine::HPA: return "HPA* (hierarchical)";
+    case Engine::Theta: return "Lazy Theta* (any-angle)";
+    case Engine::Bidir: return "Bidirectional A* (2 threads)";
+    case Engine::Flow: return "Flow field (reused while the goal stays)";
+    case Engine::Lattice: return "State lattice (turning radius 3)";
+    default: return "?";
+  }
+}
+
 static std::string nowTimestamp() {
   auto t = std::time(nullptr);
   std::tm tm{};
@@ -39,7 +70,11 @@ int main(int argc, char** argv) {
   int mapW = 120, mapH = 80;
   int cliRects = 18, cliMin = 3, cliMax = 12;
   unsigned cliSeed = 12345u;
-  std::string pngPath;
+  std::string pngPath;          // .png, or .pptm (tiled map, see map_convert)
+  int viewX = 0, viewY = 0, viewW = -1, viewH = -1; // window of a .pptm map
+  std::string logMode = "csv"; // csv | bin | off
+  std::string tracePath;        // Chrome trace written on exit (profiling builds)
+  float statsPeriod = 0.f;      // seconds between profiler summaries, 0 = off
 
   auto parseSize = [&](const std::string& s, int& W, int& H) {
     auto xpos = s.find('x');
@@ -64,6 +99,20 @@ int main(int argc, char** argv) {
     if (a == "--max" && i + 1 < argc) { cliMax = std::max(cliMin, std::atoi(argv[++i])); continue; }
     if (a.rfind("--seed=", 0) == 0) { cliSeed = static_cast<unsigned>(std::strtoul(a.c_str() + 7, nullptr, 10)); continue; }
     if (a == "--seed" && i + 1 < argc) { cliSeed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)); continue; }
+    if (a.rfind("--log=", 0) == 0) { logMode = a.substr(6); continue; }
+    if (a == "--log" && i + 1 < argc) { logMode = argv[++i]; continue; }
+    if (a.rfind("--trace=", 0) == 0) { tracePath = a.substr(8); continue; }
+    if (a == "--trace" && i + 1 < argc) { tracePath = argv[++i]; continue; }
+    if (a.rfind("--stats=", 0) == 0) { statsPeriod = std::max(0.f, float(std::atof(a.c_str() + 8))); continue; }
+    if (a == "--stats" && i + 1 < argc) { statsPeriod = std::max(0.f, float(std::atof(argv[++i]))); continue; }
+    if (a.rfind("--view=", 0) == 0 || (a == "--view" && i + 1 < argc)) {
+      const std::string v = a == "--view" ? argv[++i] : a.substr(7);
+      if (std::sscanf(v.c_str(), "%d,%d,%d,%d", &viewX, &viewY, &viewW, &viewH) != 4) {
+        std::cerr << "Bad --view '" << v << "' (expected X,Y,W,H), loading the whole map\n";
+        viewX = viewY = 0; viewW = viewH = -1;
+      }
+      continue;
+    }
     if (!a.empty() && a[0] != '-' && pngPath.empty()) { pngPath = a; }
   }
 
@@ -75,11 +124,16 @@ int main(int argc, char** argv) {
               << ", rects=" << cliRects << ", size=[" << cliMin << "," << cliMax
               << "], seed=" << cliSeed << "\n";
   } else if (!pngPath.empty()) {
-    loaded = map.loadPNG(pngPath);
+    loaded = loadMap(map, pngPath, viewX, viewY, viewW, viewH);
     if (!loaded) std::cerr << "Failed to load map from '" << pngPath << "', using demo.\n";
   }
   if (!loaded) map.makeDemo(mapW, mapH);
 
+  if ((!tracePath.empty() || statsPeriod > 0.f) && !prof::enabled())
+    std::cerr << "--trace/--stats need a build with -DENABLE_PROFILING=ON, ignoring\n";
+  if (!tracePath.empty() && prof::enabled()) prof::Registry::get().startTrace();
+  PP_PROF_THREAD("main");
+
   const float scale = 8.f; // pixels per cell
 #if SFML_VERSION_MAJOR >= 3
   sf::RenderWindow window(sf::VideoMode(sf::Vector2u{static_cast<unsigned>(map.w * scale), static_cast<unsigned>(map.h * scale)}), "Path Planning & Control Sandbox");
@@ -91,45 +145,176 @@ int main(int argc, char** argv) {
   // HUD text removed: no font dependency
 
   // Sim state
-  sf::Vector2i start{1, 1};
-  sf::Vector2i goal{map.w - 2, map.h - 2};
+  Vec2i start{1, 1};
+  Vec2i goal{map.w - 2, map.h - 2};
   RobotState state{start.x + 0.5f, start.y + 0.5f, 0.f};
   PurePursuit ctrl{2.0f, 2.0f};
   PIDLateralController pid{}; pid.targetSpeed = ctrl.targetSpeed;
-  std::vector<sf::Vector2i> gridPath;
-  std::vector<sf::Vector2f> smoothPath;
+  astar::Planner planner; // keeps search buffers between replans
+  jps::Planner jpsPlanner;
+  dstar::Planner dstarPlanner; // keeps its search tree across edits and start moves
+  hpa::Planner hpaPlanner;
+  theta::Planner thetaPlanner; // any-angle: few waypoints
+  bidir::Planner bidirPlanner(true); // forward and backward frontiers on two threads
+  flow::FlowField flowField;         // one reverse search per goal; starts just descend it
+  lattice::Planner latticePlanner(3.f, 0.4f, 0.1f, -1.f); // forward-only curves: the controllers cannot reverse
+  std::vector<Vec2i> gridPath;
+  TrackedPath smoothPath; // cached arc length + progress for the controllers
+  bool curvedPath = false; // smoothPath is a lattice curve, used as planned
   int smoothingIters = 2;
   bool showLookahead = true;
   bool showRawPath = false;
   bool usePID = false;
+  Engine engine = Engine::AStar;
   unsigned randSeed = 12345u; bool deterministic = true;
   int rects = 18, rectMin = 3, rectMax = 12;
 
-  // CSV logging
-  std::filesystem::create_directories("logs");
-  std::string csvPath = std::string("logs/run_") + nowTimestamp() + ".csv";
-  std::ofstream csv(csvPath);
-  csv << "t,x,y,theta,v,omega,err_lat,path_len,plan_ms\n";
+  // Telemetry logging (written by a background thread)
+  telemetry::Writer telemetryLog;
+  if (logMode == "csv" || logMode == "bin") {
+    std::filesystem::create_directories("logs");
+    bool bin = logMode == "bin";
+    std::string logPath = std::string("logs/run_") + nowTimestamp() + (bin ? ".ptl" : ".csv");
+    telemetryLog.open(logPath, bin ? telemetry::Format::Binary : telemetry::Format::Csv);
+  } else if (logMode != "off") {
+    std::cerr << "Unknown --log mode '" << logMode << "' (csv|bin|off), logging disabled\n";
+  }
   double simTime = 0.0;
 
-  auto replan = [&](bool reset_pose) {
-    auto t0 = Clock::now();
-    gridPath = astar::plan(map, start, goal);
-    smoothPath.clear();
-    if (!gridPath.empty()) {
-      auto f = astar::toFloatCenter(gridPath);
-      smoothPath = astar::chaikin(f, smoothingIters);
+  // Render caches: occupancy textures and path vertex arrays
+  MapLayer mapLayer;
+  auto toPix = [&](Vec2f p) { return sf::Vector2f{p.x * scale, p.y * scale}; };
+#if SFML_VERSION_MAJOR >= 3
+  sf::VertexArray smoothVa(sf::PrimitiveType::LineStrip), rawVa(sf::PrimitiveType::LineStrip);
+#else
+  sf::VertexArray smoothVa(sf::LineStrip), rawVa(sf::LineStrip);
+#endif
+
+  // Rebuild both path vertex arrays; called only when the path changes.
+  auto rebuildPathVertices = [&]() {
+    rawVa.resize(gridPath.size());
+    for (size_t i = 0; i < gridPath.size(); ++i) {
+      rawVa[i].position = toPix({gridPath[i].x + 0.5f, gridPath[i].y + 0.5f});
+      rawVa[i].color = sf::Color(100, 100, 255);
+    }
+    smoothVa.resize(smoothPath.size());
+    for (size_t i = 0; i < smoothPath.size(); ++i) {
+      smoothVa[i].position = toPix(smoothPath[i]);
+      smoothVa[i].color = sf::Color(255, 140, 0);
     }
-    auto t1 = Clock::now();
-    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
-    if (reset_pose) {
+  };
+
+  // Post-processing (collinear removal, line-of-sight shortcutting, Chaikin
+  // levels that stay collision free). One pipeline per thread, since each
+  // owns its scratch buffers.
+  postproc::Pipeline postMain, postWorker;
+  std::vector<Vec2f> postOut;
+
+  // Re-smooth the current grid path (smoothing level changed).
+  auto resmooth = [&]() {
+    PP_PROF_SCOPE("resmooth");
+    if (curvedPath) return;
+    postMain.opts.chaikinIters = smoothingIters;
+    postMain.run(&map, gridPath, postOut);
+    smoothPath.assign(postOut);
+    rebuildPathVertices();
+  };
+
+  // Planning runs on a worker thread against a snapshot of the map. The
+  // planners below are only touched from that thread from here on.
+  worker::PlanWorker planWorker([&](const worker::Request& req, worker::Result& res) {
+    const GridMap& m = *req.map;
+    PP_PROF_SCOPE("plan.search");
+    switch (Engine(req.engine)) {
+      case Engine::JPS:
+        jpsPlanner.sync(m); // cheap bit-packing; map may have been edited or regenerated
+        jpsPlanner.plan(m, req.start, req.goal, res.path);
+        break;
+      case Engine::DStarLite:
+        dstarPlanner.sync(m); // repairs only the cells that changed since the last plan
+        dstarPlanner.plan(m, req.start, req.goal, res.path);
+        break;
+      case Engine::HPA:
+        hpaPlanner.sync(m); // rebuilds only the clusters whose cells changed
+        hpaPlanner.plan(m, req.start, req.goal, res.path);
+        break;
+      case Engine::Theta:
+        thetaPlanner.plan(m, req.start, req.goal, res.path);
+        break;
+      case Engine::Bidir:
+        bidirPlanner.plan(m, req.start, req.goal, res.path);
+        break;
+      case Engine::Flow:
+        flowField.sync(m); // rebuilt only if the map or the goal changed
+        flowField.plan(m, req.start, req.goal, res.path);
+        break;
+      case Engine::Lattice:
+        // The curve already respects the turning radius: no smoothing
+        if (latticePlanner.plan(m, req.start, 0.f, req.goal, res.smooth)) res.path = latticePlanner.lastCells();
+        return;
+      default:
+        planner.plan(m, req.start, req.goal, res.path);
+        break;
+    }
+    PP_PROF_SCOPE("plan.smooth");
+    postWorker.opts.chaikinIters = req.smoothing;
+    postWorker.run(&m, res.path, res.smooth);
+  });
+  planner.setCancelFlag(planWorker.cancelFlag());
+  jpsPlanner.setCancelFlag(planWorker.cancelFlag());
+  dstarPlanner.setCancelFlag(planWorker.cancelFlag());
+  hpaPlanner.setCancelFlag(planWorker.cancelFlag());
+  thetaPlanner.setCancelFlag(planWorker.cancelFlag());
+  bidirPlanner.setCancelFlag(planWorker.cancelFlag());
+  flowField.setCancelFlag(planWorker.cancelFlag());
+  latticePlanner.setCancelFlag(planWorker.cancelFlag());
+
+  // Latest request wins: a newer replan cancels the one in flight, and the
+  // robot keeps tracking the current path until the new one is published.
+  bool pendingReset = false;
+  // Map snapshots handed to the worker. Requests for an unchanged map share
+  // the last one; otherwise a buffer no request holds any more is brought up
+  // to date by mirroring, which copies only the journaled edits and keeps the
+  // worker's planners on the map's lineage for their incremental syncs.
+  std::vector<std::shared_ptr<GridMap>> snapshots;
+  std::shared_ptr<const GridMap> snapshot;
+  auto takeSnapshot = [&]() {
+    if (snapshot && snapshot->version() == map.version()) return snapshot;
+    snapshot.reset();
+    std::shared_ptr<GridMap> buf;
+    for (auto& s : snapshots)
+      if (s.use_count() == 1) { buf = s; break; }
+    if (!buf) { buf = std::make_shared<GridMap>(); snapshots.push_back(buf); }
+    std::atomic_thread_fence(std::memory_order_acquire); // see the worker's last reads of buf
+    buf->mirror(map);
+    snapshot = buf;
+    return snapshot;
+  };
+  auto replan = [&](bool reset_pose) {
+    planWorker.submit({takeSnapshot(), start, goal, int(engine), smoothingIters, 0});
+    if (reset_pose) pendingReset = true;
+    mapLayer.sync(map); // every map edit or regeneration goes through replan
+  };
+
+  double lastPlanMs = 0.0;
+  // Swap in a finished plan, if any.
+  auto publishPlan = [&]() {
+    worker::Result res;
+    if (!planWorker.poll(res)) return;
+    PP_PROF_SCOPE("plan.publish");
+    gridPath.swap(res.path);
+    curvedPath = Engine(res.engine) == Engine::Lattice;
+    if (curvedPath || res.smoothing == smoothingIters) { smoothPath.assign(std::move(res.smooth)); rebuildPathVertices(); }
+    else resmooth();
+    lastPlanMs = res.ms;
+    if (pendingReset) {
       state = {start.x + 0.5f, start.y + 0.5f, 0.f};
       pid.integral = 0.f; pid.prevErr = 0.f;
+      pendingReset = false;
     }
-    return ms;
   };
 
-  double lastPlanMs = replan(true);
+  replan(true);
 
   // Timing
   const float dt = 1.f / 120.f; // physics step
@@ -149,12 +334,13 @@ int main(int argc, char** argv) {
   sf::RectangleShape goalRect({scale, scale});
   goalRect.setFillColor(sf::Color(255, 0, 0));
 
-  auto toPix = [&](sf::Vector2f p) { return sf::Vector2f{p.x * scale, p.y * scale}; };
 
   // removed unused lastFpsUpdate
 
   float cmd_v = 0.f, cmd_w = 0.f;
+  auto statsT0 = Clock::now();
   while (window.isOpen()) {
+    PP_PROF_SCOPE("frame");
     // Events
     #if SFML_VERSION_MAJOR >= 3
     while (auto ev = window.pollEvent()) {
@@ -166,28 +352,30 @@ int main(int argc, char** argv) {
           bool shiftDown = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::LShift) || sf::Keyboard::isKeyPressed(sf::Keyboard::Key::RShift);
           if (mb->button == sf::Mouse::Button::Left) {
             if (shiftDown) {
-              map.toggle(gx, gy);
-              for (int x = 0; x < map.w; ++x) { map.setOcc(x, 0, 1); map.setOcc(x, map.h-1, 1); }
-              for (int y = 0; y < map.h; ++y) { map.setOcc(0, y, 1); map.setOcc(map.w-1, y, 1); }
-              lastPlanMs = replan(false);
+              if (gx > 0 && gy > 0 && gx < map.w - 1 && gy < map.h - 1) { map.toggle(gx, gy); replan(false); } // border cells stay as they are
             } else if (map.isFree(gx, gy)) {
-              start = {gx, gy}; lastPlanMs = replan(true);
+              start = {gx, gy}; replan(true);
             }
           } else if (mb->button == sf::Mouse::Button::Right) {
-            if (map.isFree(gx, gy)) { goal = {gx, gy}; lastPlanMs = replan(false); }
+            if (map.isFree(gx, gy)) { goal = {gx, gy}; replan(false); }
           }
         }
       }
       if (const auto* kp = ev->getIf<sf::Event::KeyPressed>()) {
-        if (kp->code == sf::Keyboard::Key::R) { lastPlanMs = replan(true); }
+        if (kp->code == sf::Keyboard::Key::R) { replan(true); }
         if (kp->code == sf::Keyboard::Key::Space) { paused = !paused; }
         if (kp->code == sf::Keyboard::Key::LBracket) { ctrl.lookahead = std::max(0.5f, ctrl.lookahead - 0.25f); }
         if (kp->code == sf::Keyboard::Key::RBracket) { ctrl.lookahead = std::min(10.f, ctrl.lookahead + 0.25f); }
         if (kp->code == sf::Keyboard::Key::Up) { ctrl.targetSpeed = std::min(10.f, ctrl.targetSpeed + 0.25f); pid.targetSpeed = ctrl.targetSpeed; }
         if (kp->code == sf::Keyboard::Key::Down) { ctrl.targetSpeed = std::max(0.f, ctrl.targetSpeed - 0.25f); pid.targetSpeed = ctrl.targetSpeed; }
-        if (kp->code == sf::Keyboard::Key::Semicolon) { smoothingIters = std::max(0, smoothingIters - 1); if (!gridPath.empty()) { auto f = astar::toFloatCenter(gridPath); smoothPath = astar::chaikin(f, smoothingIters); } }
-        if (kp->code == sf::Keyboard::Key::Apostrophe) { smoothingIters = std::min(6, smoothingIters + 1); if (!gridPath.empty()) { auto f = astar::toFloatCenter(gridPath); smoothPath = astar::chaikin(f, smoothingIters); } }
+        if (kp->code == sf::Keyboard::Key::Semicolon) { smoothingIters = std::max(0, smoothingIters - 1); resmooth(); }
+        if (kp->code == sf::Keyboard::Key::Apostrophe) { smoothingIters = std::min(6, smoothingIters + 1); resmooth(); }
         if (kp->code == sf::Keyboard::Key::C) { usePID = !usePID; }
+        if (kp->code == sf::Keyboard::Key::M) {
+          engine = static_cast<Engine>((static_cast<int>(engine) + 1) % static_cast<int>(Engine::Count));
+          std::cout << "Planner: " << engineName(engine) << "\n";
+          replan(false);
+        }
         if (kp->code == sf::Keyboard::Key::P) { showRawPath = !showRawPath; }
         if (kp->code == sf::Keyboard::Key::V) { showLookahead = !showLookahead; }
         if (kp->code == sf::Keyboard::Key::N) {
@@ -196,22 +384,22 @@ int main(int argc, char** argv) {
           start = {1,1}; goal = {map.w-2, map.h-2};
           if (!map.isFree(start.x, start.y)) start = {2,2};
           if (!map.isFree(goal.x, goal.y)) goal = {map.w-3, map.h-3};
-          lastPlanMs = replan(true);
+          replan(true);
           if (deterministic) randSeed++;
           errSumSq = 0.0; errCount = 0;
         }
         if (kp->code == sf::Keyboard::Key::T) { deterministic = !deterministic; }
-        if (kp->code == sf::Keyboard::Key::Num1) { map.makeOpen(map.w, map.h); lastPlanMs = replan(true); errSumSq = 0.0; errCount = 0; }
-        if (kp->code == sf::Keyboard::Key::Num2) { map.makeDemo(map.w, map.h); lastPlanMs = replan(true); errSumSq = 0.0; errCount = 0; }
-        if (kp->code == sf::Keyboard::Key::Num3) { map.makeRandom(map.w, map.h, rects*2, 2, rectMax, 42u); lastPlanMs = replan(true); errSumSq = 0.0; errCount = 0; }
-        if (kp->code == sf::Keyboard::Key::O) { std::filesystem::create_directories("assets/maps"); map.savePNG("assets/maps/saved.png"); }
+        if (kp->code == sf::Keyboard::Key::Num1) { map.makeOpen(map.w, map.h); replan(true); errSumSq = 0.0; errCount = 0; }
+        if (kp->code == sf::Keyboard::Key::Num2) { map.makeDemo(map.w, map.h); replan(true); errSumSq = 0.0; errCount = 0; }
+        if (kp->code == sf::Keyboard::Key::Num3) { map.makeRandom(map.w, map.h, rects*2, 2, rectMax, 42u); replan(true); errSumSq = 0.0; errCount = 0; }
+        if (kp->code == sf::Keyboard::Key::O) { std::filesystem::create_directories("assets/maps"); savePNG(map, "assets/maps/saved.png"); }
         if (kp->code == sf::Keyboard::Key::S || kp->code == sf::Keyboard::Key::G) {
           auto m = sf::Mouse::getPosition(window);
           int gx = static_cast<int>(m.x / scale);
           int gy = static_cast<int>(m.y / scale);
           if (map.inBounds(gx, gy) && map.isFree(gx, gy)) {
-            if (kp->code == sf::Keyboard::Key::S) { start = {gx, gy}; lastPlanMs = replan(true); }
-            if (kp->code == sf::Keyboard::Key::G) { goal = {gx, gy}; lastPlanMs = replan(false); }
+            if (kp->code == sf::Keyboard::Key::S) { start = {gx, gy}; replan(true); }
+            if (kp->code == sf::Keyboard::Key::G) { goal = {gx, gy}; replan(false); }
           }
         }
       }
@@ -227,23 +415,28 @@ int main(int argc, char** argv) {
         if (map.inBounds(gx, gy)) {
           bool shiftDown = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) || sf::Keyboard::isKeyPressed(sf::Keyboard::RShift);
           if (e.mouseButton.button == sf::Mouse::Left) {
-            if (shiftDown) { map.toggle(gx, gy); for (int x = 0; x < map.w; ++x) { map.setOcc(x, 0, 1); map.setOcc(x, map.h-1, 1);} for (int y = 0; y < map.h; ++y) { map.setOcc(0, y, 1); map.setOcc(map.w-1, y, 1);} lastPlanMs = replan(false); }
-            else if (map.isFree(gx, gy)) { start = {gx, gy}; lastPlanMs = replan(true); }
+            if (shiftDown) { if (gx > 0 && gy > 0 && gx < map.w - 1 && gy < map.h - 1) { map.toggle(gx, gy); replan(false); } }
+            else if (map.isFree(gx, gy)) { start = {gx, gy}; replan(true); }
           } else if (e.mouseButton.button == sf::Mouse::Right) {
-            if (map.isFree(gx, gy)) { goal = {gx, gy}; lastPlanMs = replan(false); }
+            if (map.isFree(gx, gy)) { goal = {gx, gy}; replan(false); }
           }
         }
       }
       if (e.type == sf::Event::KeyPressed) {
-        if (e.key.code == sf::Keyboard::R) { lastPlanMs = replan(true); }
+        if (e.key.code == sf::Keyboard::R) { replan(true); }
         if (e.key.code == sf::Keyboard::Space) { paused = !paused; }
         if (e.key.code == sf::Keyboard::LBracket) { ctrl.lookahead = std::max(0.5f, ctrl.lookahead - 0.25f); }
         if (e.key.code == sf::Keyboard::RBracket) { ctrl.lookahead = std::min(10.f, ctrl.lookahead + 0.25f); }
         if (e.key.code == sf::Keyboard::Up) { ctrl.targetSpeed = std::min(10.f, ctrl.targetSpeed + 0.25f); pid.targetSpeed = ctrl.targetSpeed; }
         if (e.key.code == sf::Keyboard::Down) { ctrl.targetSpeed = std::max(0.f, ctrl.targetSpeed - 0.25f); pid.targetSpeed = ctrl.targetSpeed; }
-        if (e.key.code == sf::Keyboard::Semicolon) { smoothingIters = std::max(0, smoothingIters - 1); if (!gridPath.empty()) { auto f = astar::toFloatCenter(gridPath); smoothPath = astar::chaikin(f, smoothingIters); } }
-        if (e.key.code == sf::Keyboard::Quote) { smoothingIters = std::min(6, smoothingIters + 1); if (!gridPath.empty()) { auto f = astar::toFloatCenter(gridPath); smoothPath = astar::chaikin(f, smoothingIters); } }
+        if (e.key.code == sf::Keyboard::Semicolon) { smoothingIters = std::max(0, smoothingIters - 1); resmooth(); }
+        if (e.key.code == sf::Keyboard::Quote) { smoothingIters = std::min(6, smoothingIters + 1); resmooth(); }
         if (e.key.code == sf::Keyboard::C) { usePID = !usePID; }
+        if (e.key.code == sf::Keyboard::M) {
+          engine = static_cast<Engine>((static_cast<int>(engine) + 1) % static_cast<int>(Engine::Count));
+          std::cout << "Planner: " << engineName(engine) << "\n";
+          replan(false);
+        }
         if (e.key.code == sf::Keyboard::P) { showRawPath = !showRawPath; }
         if (e.key.code == sf::Keyboard::V) { showLookahead = !showLookahead; }
         if (e.key.code == sf::Keyboard::N) {
@@ -252,28 +445,31 @@ int main(int argc, char** argv) {
           start = {1,1}; goal = {map.w-2, map.h-2};
           if (!map.isFree(start.x, start.y)) start = {2,2};
           if (!map.isFree(goal.x, goal.y)) goal = {map.w-3, map.h-3};
-          lastPlanMs = replan(true);
+          replan(true);
           if (deterministic) randSeed++;
           errSumSq = 0.0; errCount = 0;
         }
         if (e.key.code == sf::Keyboard::T) { deterministic = !deterministic; }
-        if (e.key.code == sf::Keyboard::Num1) { map.makeOpen(map.w, map.h); lastPlanMs = replan(true); errSumSq = 0.0; errCount = 0; }
-        if (e.key.code == sf::Keyboard::Num2) { map.makeDemo(map.w, map.h); lastPlanMs = replan(true); errSumSq = 0.0; errCount = 0; }
-        if (e.key.code == sf::Keyboard::Num3) { map.makeRandom(map.w, map.h, rects*2, 2, rectMax, 42u); lastPlanMs = replan(true); errSumSq = 0.0; errCount = 0; }
-        if (e.key.code == sf::Keyboard::O) { std::filesystem::create_directories("assets/maps"); map.savePNG("assets/maps/saved.png"); }
+        if (e.key.code == sf::Keyboard::Num1) { map.makeOpen(map.w, map.h); replan(true); errSumSq = 0.0; errCount = 0; }
+        if (e.key.code == sf::Keyboard::Num2) { map.makeDemo(map.w, map.h); replan(true); errSumSq = 0.0; errCount = 0; }
+        if (e.key.code == sf::Keyboard::Num3) { map.makeRandom(map.w, map.h, rects*2, 2, rectMax, 42u); replan(true); errSumSq = 0.0; errCount = 0; }
+        if (e.key.code == sf::Keyboard::O) { std::filesystem::create_directories("assets/maps"); savePNG(map, "assets/maps/saved.png"); }
         if (e.key.code == sf::Keyboard::S || e.key.code == sf::Keyboard::G) {
           sf::Vector2i m = sf::Mouse::getPosition(window);
           int gx = static_cast<int>(m.x / scale);
           int gy = static_cast<int>(m.y / scale);
           if (map.inBounds(gx, gy) && map.isFree(gx, gy)) {
-            if (e.key.code == sf::Keyboard::S) { start = {gx, gy}; lastPlanMs = replan(true); }
-            if (e.key.code == sf::Keyboard::G) { goal = {gx, gy}; lastPlanMs = replan(false); }
+            if (e.key.code == sf::Keyboard::S) { start = {gx, gy}; replan(true); }
+            if (e.key.code == sf::Keyboard::G) { goal = {gx, gy}; replan(false); }
           }
         }
       }
     }
     #endif
 
+    // Pick up a finished background plan (never waits for one)
+    publishPlan();
+
     // Update timing
     float frame = clock.restart().asSeconds();
     accumulator += frame;
@@ -282,11 +478,15 @@ int main(int argc, char** argv) {
     // Physics steps
     int steps = 0;
     while (accumulator >= dt) {
+      PP_PROF_SCOPE("sim.tick");
       if (!paused && !smoothPath.empty()) {
-        auto [v, w] = usePID ? pid.control(state, smoothPath, dt) : ctrl.control(state, smoothPath);
+        auto [v, w] = [&]() {
+          PP_PROF_SCOPE("controller");
+          return usePID ? pid.control(state, smoothPath, dt) : ctrl.control(state, smoothPath);
+        }();
         // Stop near goal
         if (!smoothPath.empty()) {
-          sf::Vector2f g = smoothPath.back();
+          Vec2f g = smoothPath.back();
           float dx = g.x - state.x, dy = g.y - state.y;
           float dist = std::sqrt(dx*dx + dy*dy);
           if (dist < 0.5f) { v = 0.f; w = 0.f; }
@@ -294,80 +494,69 @@ int main(int argc, char** argv) {
         cmd_v = v; cmd_w = w;
         integrate(state, cmd_v, cmd_w, dt);
 
-        // Log CSV
+        // Log telemetry
         float err = lateralError(state, smoothPath);
         errSumSq += double(err) * double(err);
         ++errCount;
-        float plen = astar::pathLength(smoothPath);
+        float plen = smoothPath.length();
         simTime += dt;
-        csv << simTime << "," << state.x << "," << state.y << "," << state.th << ","
-            << (paused ? 0.f : cmd_v) << "," << (paused ? 0.f : cmd_w) << ","
-            << err << "," << plen << "," << lastPlanMs << "\n";
+        PP_PROF_SCOPE("telemetry.push");
+        telemetryLog.push({simTime, state.x, state.y, state.th,
+                           paused ? 0.f : cmd_v, paused ? 0.f : cmd_w,
+                           err, plen, float(lastPlanMs)});
       }
       accumulator -= dt;
       if (++steps > 5) { accumulator = 0.f; break; }
     }
 
     // Render
-    window.clear(sf::Color(30, 30, 30));
-    map.draw(window, scale);
-
-    // Start/goal
-    startRect.setPosition(sf::Vector2f{start.x * scale, start.y * scale});
-    goalRect.setPosition(sf::Vector2f{goal.x * scale, goal.y * scale});
-    window.draw(startRect);
-    window.draw(goalRect);
-
-    // Path render
-    if (showRawPath && gridPath.size() >= 2) {
-      auto raw = astar::toFloatCenter(gridPath);
-#if SFML_VERSION_MAJOR >= 3
-      sf::VertexArray vaRaw(sf::PrimitiveType::LineStrip, raw.size());
-#else
-      sf::VertexArray vaRaw(sf::LineStrip, raw.size());
-#endif
-      for (size_t i = 0; i < raw.size(); ++i) {
-        vaRaw[i].position = toPix(raw[i]);
-        vaRaw[i].color = sf::Color(100, 100, 255);
-      }
-      window.draw(vaRaw);
-    }
-    if (smoothPath.size() >= 2) {
-#if SFML_VERSION_MAJOR >= 3
-      sf::VertexArray va(sf::PrimitiveType::LineStrip, smoothPath.size());
-#else
-      sf::VertexArray va(sf::LineStrip, smoothPath.size());
-#endif
-      for (size_t i = 0; i < smoothPath.size(); ++i) {
-        va[i].position = toPix(smoothPath[i]);
-        va[i].color = sf::Color(255, 140, 0);
+    {
+      PP_PROF_SCOPE("render");
+      window.clear(sf::Color(30, 30, 30));
+      mapLayer.draw(window, scale);
+
+      // Start/goal
+      startRect.setPosition(sf::Vector2f{start.x * scale, start.y * scale});
+      goalRect.setPosition(sf::Vector2f{goal.x * scale, goal.y * scale});
+      window.draw(startRect);
+      window.draw(goalRect);
+
+      // Path render (vertex arrays are rebuilt by resmooth)
+      if (showRawPath && rawVa.getVertexCount() >= 2) window.draw(rawVa);
+      if (smoothVa.getVertexCount() >= 2) window.draw(smoothVa);
+
+      // Robot
+      robotShape.setPosition(sf::Vector2f{state.x * scale, state.y * scale});
+      #if SFML_VERSION_MAJOR >= 3
+      robotShape.setRotation(sf::degrees(state.th * 180.f / 3.14159265f));
+      #else
+      robotShape.setRotation(state.th * 180.f / 3.14159265f);
+      #endif
+      window.draw(robotShape);
+
+      // HUD text removed; overlays (path, robot, lookahead) still drawn
+
+      // Lookahead target render
+      if (showLookahead && !smoothPath.empty()) {
+        Vec2f tpt = ctrl.targetPoint(state, smoothPath);
+        sf::CircleShape lh(0.2f * scale);
+        lh.setOrigin(sf::Vector2f{0.2f * scale, 0.2f * scale});
+        lh.setFillColor(sf::Color(0,255,0,160));
+        lh.setPosition(toPix(tpt));
+        window.draw(lh);
       }
-      window.draw(va);
     }
+    window.display(); // outside "render": it sleeps for the frame limit
 
-    // Robot
-    robotShape.setPosition(sf::Vector2f{state.x * scale, state.y * scale});
-    #if SFML_VERSION_MAJOR >= 3
-    robotShape.setRotation(sf::degrees(state.th * 180.f / 3.14159265f));
-    #else
-    robotShape.setRotation(state.th * 180.f / 3.14159265f);
-    #endif
-    window.draw(robotShape);
-
-    // HUD text removed; overlays (path, robot, lookahead) still drawn
-
-    // Lookahead target render
-    if (showLookahead && !smoothPath.empty()) {
-      sf::Vector2f tpt = ctrl.targetPoint(state, smoothPath);
-      sf::CircleShape lh(0.2f * scale);
-      lh.setOrigin(sf::Vector2f{0.2f * scale, 0.2f * scale});
-      lh.setFillColor(sf::Color(0,255,0,160));
-      lh.setPosition(toPix(tpt));
-      window.draw(lh);
+    if (prof::enabled() && statsPeriod > 0.f) {
+      double since = std::chrono::duration<double>(Clock::now() - statsT0).count();
+      if (since >= statsPeriod) {
+        prof::Registry::get().report(std::cerr, since);
+        statsT0 = Clock::now();
+      }
     }
-
-    window.display();
   }
 
+  if (!tracePath.empty() && prof::enabled()) prof::Registry::get().writeChromeTrace(tracePath);
   return 0;
 }
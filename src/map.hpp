@@ -1,51 +1,175 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
-#include <SFML/Config.hpp>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <utility>
 #include <string>
 #include <vector>
 #include <random>
 #include <algorithm>
 
+// Cells [x0, x1) x [y0, y1).
+struct DirtyRect {
+  int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+  bool empty() const { return x0 >= x1 || y0 >= y1; }
+  void add(int x, int y) {
+    if (empty()) { x0 = x; y0 = y; x1 = x + 1; y1 = y + 1; return; }
+    x0 = std::min(x0, x); y0 = std::min(y0, y);
+    x1 = std::max(x1, x + 1); y1 = std::max(y1, y + 1);
+  }
+};
+
+// One occupancy state of a GridMap. `lineage` changes whenever the map is
+// replaced wholesale (regenerated, loaded, resized); `version` counts the
+// edit transactions since. A copy starts a lineage of its own, so caches
+// synced to the original resync fully against it.
+struct MapVersion {
+  uint64_t lineage = 0; // 0 never names a real map
+  uint64_t version = 0;
+  bool operator==(const MapVersion& o) const { return lineage == o.lineage && version == o.version; }
+  bool operator!=(const MapVersion& o) const { return !(*this == o); }
+};
+
+// Occupancy grid with a change journal. Edits through setOcc/toggle are
+// grouped into transactions (beginEdit/endEdit or GridMap::Edit); each
+// transaction that changes anything bumps the version once and records the
+// bounding rectangle of its changes. Consumers remember the version they
+// last synced to and ask changesSince() which rectangles to look at, instead
+// of diffing or rebuilding the whole map. Code that writes `occ` (or w/h)
+// directly must call replaced() afterwards.
 struct GridMap {
   int w = 0;
   int h = 0;
   // 0 = free, 1 = obstacle
   std::vector<uint8_t> occ;
 
+  GridMap() = default;
+  // Copies and moved-from maps get a new lineage and an empty journal:
+  // editing both sides would otherwise reach the same version with
+  // different cells, and changesSince() would describe the wrong edits.
+  GridMap(const GridMap& o) : w(o.w), h(o.h), occ(o.occ) { replaced(); }
+  GridMap(GridMap&& o) noexcept
+      : w(o.w), h(o.h), occ(std::move(o.occ)), lineage_(o.lineage_), version_(o.version_), base_(o.base_),
+        journal_(std::move(o.journal_)), pending_(o.pending_), mirror_(o.mirror_) {
+    o.replaced();
+  }
+  GridMap& operator=(const GridMap& o) {
+    if (this == &o) return *this;
+    w = o.w; h = o.h; occ = o.occ;
+    editDepth_ = 0;
+    replaced();
+    return *this;
+  }
+  GridMap& operator=(GridMap&& o) noexcept {
+    if (this == &o) return *this;
+    w = o.w; h = o.h; occ = std::move(o.occ);
+    lineage_ = o.lineage_; version_ = o.version_; base_ = o.base_;
+    journal_ = std::move(o.journal_);
+    pending_ = o.pending_;
+    editDepth_ = 0;
+    mirror_ = o.mirror_;
+    o.replaced();
+    return *this;
+  }
+
   bool inBounds(int x, int y) const { return x >= 0 && y >= 0 && x < w && y < h; }
   bool isFree(int x, int y) const { return inBounds(x, y) && occ[y * w + x] == 0; }
 
+  // Bit k set when the neighbor (x + dx[k], y + dy[k]) is free, using the
+  // planner's direction order {1,0},{1,1},{0,1},{-1,1},{-1,0},{-1,-1},{0,-1},{1,-1}.
+  uint8_t freeMask(int x, int y) const {
+    const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    uint8_t m = 0;
+    for (int k = 0; k < 8; ++k)
+      if (isFree(x + dx[k], y + dy[k])) m |= uint8_t(1u << k);
+    return m;
+  }
+
   void setOcc(int x, int y, uint8_t val) {
-    if (inBounds(x, y)) occ[y * w + x] = val ? 1 : 0;
+    if (!inBounds(x, y)) return;
+    const uint8_t v = val ? 1 : 0;
+    if (occ[y * w + x] == v) return;
+    occ[y * w + x] = v;
+    changed(x, y);
   }
 
   void toggle(int x, int y) {
-    if (inBounds(x, y)) occ[y * w + x] = occ[y * w + x] ? 0 : 1;
-  }
-
-  bool loadPNG(const std::string& path) {
-    sf::Image img;
-    if (!img.loadFromFile(path)) return false;
-    w = static_cast<int>(img.getSize().x);
-    h = static_cast<int>(img.getSize().y);
-    occ.assign(w * h, 0);
-    // Expect white=free, black=obstacle (threshold on luminance)
-    for (int y = 0; y < h; ++y) {
-      for (int x = 0; x < w; ++x) {
-#if SFML_VERSION_MAJOR >= 3
-        sf::Color c = img.getPixel(sf::Vector2u{static_cast<unsigned>(x), static_cast<unsigned>(y)});
-#else
-        sf::Color c = img.getPixel(x, y);
-#endif
-        float lum = 0.2126f * (c.r / 255.f) + 0.7152f * (c.g / 255.f) + 0.0722f * (c.b / 255.f);
-        occ[y * w + x] = (lum < 0.5f) ? 1 : 0;
-      }
+    if (!inBounds(x, y)) return;
+    occ[y * w + x] = occ[y * w + x] ? 0 : 1;
+    changed(x, y);
+  }
+
+  // Edit transactions nest; the outermost endEdit() commits. Edits outside a
+  // transaction commit one by one.
+  void beginEdit() { ++editDepth_; }
+  void endEdit() {
+    if (editDepth_ == 0 || --editDepth_ > 0 || pending_.empty()) return;
+    ++version_;
+    journal_.push_back({version_, pending_});
+    pending_ = {};
+    if (journal_.size() > kJournalSize) { // forget the oldest: consumers that far behind resync fully
+      base_ = journal_.front().version;
+      journal_.erase(journal_.begin());
     }
+  }
+
+  // Scoped transaction: { GridMap::Edit edit(map); map.setOcc(...); ... }
+  class Edit {
+  public:
+    explicit Edit(GridMap& map) : map_(map) { map_.beginEdit(); }
+    ~Edit() { map_.endEdit(); }
+    Edit(const Edit&) = delete;
+    Edit& operator=(const Edit&) = delete;
+  private:
+    GridMap& map_;
+  };
+
+  // Start a new lineage after `occ`, w or h were replaced directly.
+  void replaced() {
+    static std::atomic<uint64_t> lineages{0};
+    lineage_ = ++lineages;
+    version_ = base_ = 0;
+    journal_.clear();
+    pending_ = {};
+    mirror_ = false;
+  }
+
+  MapVersion version() const { return {lineage_, version_}; }
+
+  // Rectangles edited after `since`, oldest first, in `out` (cleared).
+  // Returns false if the journal cannot tell (another lineage, or older than
+  // the journal reaches): treat every cell as changed then.
+  bool changesSince(const MapVersion& since, std::vector<DirtyRect>& out) const {
+    out.clear();
+    if (since.lineage != lineage_ || lineage_ == 0 || since.version < base_ || since.version > version_) return false;
+    for (const Entry& e : journal_)
+      if (e.version > since.version) out.push_back(e.rect);
     return true;
   }
 
+  // Make this map a replica of `src` at its current version, sharing its
+  // lineage and journal. If this map last mirrored an earlier version of
+  // `src`, only the journaled rectangles are copied. Editing a mirror
+  // detaches it (new lineage), so it never diverges under the shared name.
+  void mirror(const GridMap& src) {
+    std::vector<DirtyRect> rects;
+    if (mirror_ && w == src.w && h == src.h && src.changesSince(version(), rects)) {
+      for (const DirtyRect& r : rects)
+        for (int y = r.y0; y < r.y1; ++y)
+          std::memcpy(&occ[size_t(y) * w + r.x0], &src.occ[size_t(y) * w + r.x0], size_t(r.x1 - r.x0));
+    } else {
+      w = src.w; h = src.h; occ = src.occ;
+    }
+    lineage_ = src.lineage_; version_ = src.version_; base_ = src.base_;
+    journal_ = src.journal_;
+    pending_ = {};
+    editDepth_ = 0;
+    mirror_ = true;
+  }
+
   void makeDemo(int W, int H) {
     w = W; h = H; occ.assign(w * h, 0);
     // Simple demo: border walls + a few blocks and corridors
@@ -59,12 +183,14 @@ struct GridMap {
     // Corridor
     for (int y = h/3; y < h/3 + 2; ++y)
       for (int x = w/5 + w/6; x < w - w/5; ++x) occ[y * w + x] = 0;
+    replaced();
   }
 
   void makeOpen(int W, int H) {
     w = W; h = H; occ.assign(w * h, 0);
     for (int x = 0; x < w; ++x) { occ[x] = 1; occ[(h-1) * w + x] = 1; }
     for (int y = 0; y < h; ++y) { occ[y * w + 0] = 1; occ[y * w + (w-1)] = 1; }
+    replaced();
   }
 
   void makeRandom(int W, int H, int nRects, int minSize, int maxSize, unsigned seed) {
@@ -85,40 +211,47 @@ struct GridMap {
         for (int x = rx; x < rx + rw && x < W - 1; ++x)
           occ[y * w + x] = 1;
     }
+    replaced();
   }
 
-  bool savePNG(const std::string& path) const {
-#if SFML_VERSION_MAJOR >= 3
-    sf::Image img(sf::Vector2u{static_cast<unsigned>(w), static_cast<unsigned>(h)}, sf::Color::White);
-    for (int y = 0; y < h; ++y) {
-      for (int x = 0; x < w; ++x) {
-        bool blocked = occ[y * w + x] != 0;
-        img.setPixel(sf::Vector2u{static_cast<unsigned>(x), static_cast<unsigned>(y)}, blocked ? sf::Color::Black : sf::Color::White);
-      }
-    }
-    return img.saveToFile(path);
-#else
-    sf::Image img; img.create(static_cast<unsigned>(w), static_cast<unsigned>(h), sf::Color::White);
-    for (int y = 0; y < h; ++y) {
-      for (int x = 0; x < w; ++x) {
-        bool blocked = occ[y * w + x] != 0;
-        img.setPixel(static_cast<unsigned>(x), static_cast<unsigned>(y), blocked ? sf::Color::Black : sf::Color::White);
-      }
-    }
-    return img.saveToFile(path);
-#endif
-  }
-
-  void draw(sf::RenderTarget& target, float scale) const {
-    sf::RectangleShape cell({scale, scale});
-    cell.setOutlineThickness(0.f);
-    for (int y = 0; y < h; ++y) {
-      for (int x = 0; x < w; ++x) {
-        uint8_t o = occ[y * w + x];
-        cell.setPosition(sf::Vector2f{static_cast<float>(x) * scale, static_cast<float>(y) * scale});
-        cell.setFillColor(o ? sf::Color::Black : sf::Color::White);
-        target.draw(cell);
+private:
+  struct Entry {
+    uint64_t version;
+    DirtyRect rect;
+  };
+  static constexpr size_t kJournalSize = 64;
+
+  uint64_t lineage_ = 0, version_ = 0;
+  uint64_t base_ = 0; // oldest version the journal can diff from
+  std::vector<Entry> journal_;
+  DirtyRect pending_; // bounding box of the open transaction's changes
+  int editDepth_ = 0;
+  bool mirror_ = false; // lineage borrowed by mirror()
+
+  void changed(int x, int y) {
+    if (mirror_) replaced();
+    pending_.add(x, y);
+    if (editDepth_ == 0) { ++editDepth_; endEdit(); }
+  }
+};
+
+// Call fn(x, y) for every cell whose occupancy in `map` differs from `snap`
+// (a copy of map.occ taken at version `since`), scanning only the journaled
+// rectangles when the journal covers `since` and the whole map otherwise.
+// fn returns false to stop early.
+template <class Fn>
+void forEachChange(const GridMap& map, const MapVersion& since, const std::vector<uint8_t>& snap, Fn&& fn) {
+  thread_local std::vector<DirtyRect> rects;
+  if (!map.changesSince(since, rects)) rects.assign(1, DirtyRect{0, 0, map.w, map.h});
+  for (const DirtyRect& r : rects) {
+    for (int y = r.y0; y < r.y1; ++y) {
+      const size_t row = size_t(y) * size_t(map.w);
+      for (int x = r.x0; x < r.x1; x += 64) {
+        const int len = std::min(64, r.x1 - x);
+        if (std::memcmp(&snap[row + size_t(x)], &map.occ[row + size_t(x)], size_t(len)) == 0) continue;
+        for (int i = x; i < x + len; ++i)
+          if ((snap[row + size_t(i)] != 0) != (map.occ[row + size_t(i)] != 0) && !fn(i, y)) return;
       }
     }
   }
-};
+}
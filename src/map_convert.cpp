@@ -0,0 +1,139 @@
+// Convert an occupancy image to the memory-mapped tiled format
+// (tiled_map.hpp), which the sandbox and plan_batch open without decoding.
+//
+//   map_convert in.png|in.pgm|in.ppm out.pptm [--tile N] [--threads N]
+//   map_convert --random WxH out.pptm [--rects N] [--seed S] [--tile N]
+//
+// Dark pixels (luminance below one half) become obstacles, as in the
+// sandbox's PNG loader. Binary PGM/PPM (P5/P6, 8-bit) always work; PNG
+// needs the build to have found SFML. Thresholding and tile packing run on
+// --threads threads (default: all cores).
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "map.hpp"
+#include "tiled_map.hpp"
+
+#if PP_WITH_SFML
+#include <SFML/Graphics.hpp>
+#endif
+
+namespace {
+
+double msSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Binary PGM (P5) or PPM (P6) with maxval 255, expanded to RGBA.
+bool readPNM(const std::string& path, int& w, int& h, std::vector<uint8_t>& rgba) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) { std::cerr << "Failed to open '" << path << "'\n"; return false; }
+  std::string magic;
+  int maxval = 0;
+  in >> magic;
+  auto field = [&](int& v) {
+    while (in >> std::ws && in.peek() == '#') in.ignore(1 << 20, '\n');
+    in >> v;
+  };
+  field(w); field(h); field(maxval);
+  in.get(); // single whitespace before the raster
+  if (!in || (magic != "P5" && magic != "P6") || maxval != 255 || w < 1 || h < 1) {
+    std::cerr << "'" << path << "' is not an 8-bit binary PGM/PPM\n";
+    return false;
+  }
+  const size_t n = size_t(w) * size_t(h), channels = magic == "P6" ? 3 : 1;
+  std::vector<uint8_t> raw(n * channels);
+  in.read(reinterpret_cast<char*>(raw.data()), std::streamsize(raw.size()));
+  if (!in) { std::cerr << "Truncated image '" << path << "'\n"; return false; }
+  rgba.resize(n * 4);
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t* p = &raw[i * channels];
+    rgba[4 * i] = p[0];
+    rgba[4 * i + 1] = p[channels == 3 ? 1 : 0];
+    rgba[4 * i + 2] = p[channels == 3 ? 2 : 0];
+    rgba[4 * i + 3] = 255;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::string in, out, randomSize;
+  int tile = 256, threads = 0, rects = 0;
+  unsigned seed = 12345u;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a == "--tile" && i + 1 < argc) tile = std::atoi(argv[++i]);
+    else if (a == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+    else if (a == "--random" && i + 1 < argc) randomSize = argv[++i];
+    else if (a == "--rects" && i + 1 < argc) rects = std::atoi(argv[++i]);
+    else if (a == "--seed" && i + 1 < argc) seed = unsigned(std::strtoul(argv[++i], nullptr, 10));
+    else if (!a.empty() && a[0] != '-' && in.empty() && randomSize.empty()) in = a;
+    else if (!a.empty() && a[0] != '-' && out.empty()) out = a;
+    else { std::cerr << "Unknown argument '" << a << "'\n"; return 1; }
+  }
+  if (out.empty() || (in.empty() && randomSize.empty())) {
+    std::cerr << "Usage: map_convert in.png|in.pgm|in.ppm out.pptm [--tile N] [--threads N]\n"
+                 "       map_convert --random WxH out.pptm [--rects N] [--seed S] [--tile N]\n";
+    return 1;
+  }
+
+  GridMap map;
+  auto t0 = std::chrono::steady_clock::now();
+  if (!randomSize.empty()) {
+    int w = 0, h = 0;
+    if (std::sscanf(randomSize.c_str(), "%dx%d", &w, &h) != 2 || w < 3 || h < 3) {
+      std::cerr << "Bad --random size '" << randomSize << "' (expected WxH)\n";
+      return 1;
+    }
+    map.makeRandom(w, h, rects > 0 ? rects : int(size_t(w) * size_t(h) / 2000), 3, 40, seed);
+    std::cout << "generated " << w << "x" << h << " in " << msSince(t0) << " ms\n";
+  } else {
+    std::vector<uint8_t> rgba;
+    const uint8_t* pixels = nullptr;
+    int w = 0, h = 0;
+#if PP_WITH_SFML
+    sf::Image img;
+#endif
+    if (endsWith(in, ".pgm") || endsWith(in, ".ppm")) {
+      if (!readPNM(in, w, h, rgba)) return 1;
+      pixels = rgba.data();
+    } else {
+#if PP_WITH_SFML
+      if (!img.loadFromFile(in)) { std::cerr << "Failed to load image '" << in << "'\n"; return 1; }
+      w = int(img.getSize().x); h = int(img.getSize().y);
+      pixels = img.getPixelsPtr();
+#else
+      std::cerr << "This build has no PNG support (SFML not found); convert '" << in << "' to PGM/PPM first\n";
+      return 1;
+#endif
+    }
+    std::cout << "decoded " << w << "x" << h << " in " << msSince(t0) << " ms\n";
+    t0 = std::chrono::steady_clock::now();
+    tiles::thresholdImage(pixels, w, h, map.occ, threads);
+    map.w = w; map.h = h;
+    map.replaced();
+    std::cout << "thresholded in " << msSince(t0) << " ms\n";
+  }
+
+  t0 = std::chrono::steady_clock::now();
+  if (!tiles::write(out, map, tile, threads)) return 1;
+  const double writeMs = msSince(t0);
+  tiles::TiledMap check;
+  if (!check.open(out)) return 1;
+  std::cout << "wrote '" << out << "' in " << writeMs << " ms: " << check.tilesX() << "x" << check.tilesY()
+            << " tiles of " << check.tileSize() << ", " << check.storedTiles() << " stored\n";
+  return 0;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+// SFML-backed map I/O and drawing. Kept out of map.hpp so the planning core
+// builds without SFML; only the sandbox includes this header.
+
+#include <SFML/Graphics.hpp>
+#include <SFML/Config.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "geometry.hpp"
+#include "map.hpp"
+#include "profiler.hpp"
+#include "tiled_map.hpp"
+
+inline sf::Vector2f toSf(Vec2f v) { return {v.x, v.y}; }
+
+// Dark pixels (luminance below one half) become obstacles. Thresholding
+// runs on the decoded pixel buffer, split across threads.
+inline bool loadPNG(GridMap& map, const std::string& path) {
+  sf::Image img;
+  if (!img.loadFromFile(path)) return false;
+  const int w = static_cast<int>(img.getSize().x);
+  const int h = static_cast<int>(img.getSize().y);
+  tiles::thresholdImage(img.getPixelsPtr(), w, h, map.occ);
+  map.w = w; map.h = h;
+  map.replaced();
+  return true;
+}
+
+inline bool savePNG(const GridMap& map, const std::string& path) {
+  const int w = map.w, h = map.h;
+  std::vector<uint8_t> pixels(map.occ.size() * 4);
+  for (size_t i = 0; i < map.occ.size(); ++i) {
+    const uint8_t c = map.occ[i] ? 0 : 255; // black = obstacle, white = free
+    pixels[4 * i] = pixels[4 * i + 1] = pixels[4 * i + 2] = c;
+    pixels[4 * i + 3] = 255;
+  }
+#if SFML_VERSION_MAJOR >= 3
+  sf::Image img(sf::Vector2u{static_cast<unsigned>(w), static_cast<unsigned>(h)}, pixels.data());
+#else
+  sf::Image img; img.create(static_cast<unsigned>(w), static_cast<unsigned>(h), pixels.data());
+#endif
+  return img.saveToFile(path);
+}
+
+// Load a map from a PNG or, for a .pptm path, from the tiled format
+// (cells [x0, x0 + ww) x [y0, y0 + hh); ww, hh < 0 = to the edge).
+inline bool loadMap(GridMap& map, const std::string& path, int x0 = 0, int y0 = 0, int ww = -1, int hh = -1) {
+  const std::string ext = ".pptm";
+  if (path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0) {
+    tiles::TiledMap tiled;
+    return tiled.open(path) && tiled.extract(map, x0, y0, ww, hh);
+  }
+  return loadPNG(map, path);
+}
+
+// Cached occupancy layer: one texel per cell in textures of up to kTile x
+// kTile cells, drawn as a few scaled sprites instead of one shape per cell.
+// sync(map) diffs the rectangles the map's journal reports since the last
+// upload against the uploaded snapshot and re-uploads only the bounding
+// rectangle of changed cells, so call it after edits (it is cheap when
+// nothing changed) and draw() every frame.
+class MapLayer {
+public:
+  static constexpr int kTile = 1024; // stays under common GPU texture limits
+
+  void sync(const GridMap& map) {
+    PP_PROF_SCOPE("render.map_sync");
+    if (map.w != w_ || map.h != h_) { rebuild(map); return; }
+    DirtyRect box; // bounding box of changed cells
+    forEachChange(map, synced_, snap_, [&](int x, int y) {
+      snap_[size_t(y) * size_t(w_) + size_t(x)] = map.occ[size_t(y) * size_t(w_) + size_t(x)];
+      box.add(x, y);
+      return true;
+    });
+    synced_ = map.version();
+    if (!box.empty()) upload(box.x0, box.y0, box.x1, box.y1);
+  }
+
+  void draw(sf::RenderTarget& target, float scale) const {
+    for (const Tile& t : tiles_) {
+      sf::Sprite sprite(t.tex);
+      sprite.setPosition(sf::Vector2f{float(t.x0) * scale, float(t.y0) * scale});
+      sprite.setScale(sf::Vector2f{scale, scale});
+      target.draw(sprite);
+    }
+  }
+
+private:
+  struct Tile {
+    sf::Texture tex;
+    int x0 = 0, y0 = 0, w = 0, h = 0;
+  };
+
+  int w_ = -1, h_ = -1;
+  MapVersion synced_;           // map version snap_ was last synced to
+  std::vector<uint8_t> snap_;   // occupancy as last uploaded
+  std::vector<uint8_t> pixels_; // RGBA staging buffer
+  std::vector<Tile> tiles_;
+
+  void rebuild(const GridMap& map) {
+    w_ = map.w; h_ = map.h;
+    snap_ = map.occ;
+    synced_ = map.version();
+    tiles_.clear();
+    const int tx = (w_ + kTile - 1) / kTile, ty = (h_ + kTile - 1) / kTile;
+    tiles_.resize(size_t(tx) * size_t(ty));
+    for (int j = 0; j < ty; ++j) {
+      for (int i = 0; i < tx; ++i) {
+        Tile& t = tiles_[size_t(j) * size_t(tx) + size_t(i)];
+        t.x0 = i * kTile; t.y0 = j * kTile;
+        t.w = std::min(kTile, w_ - t.x0); t.h = std::min(kTile, h_ - t.y0);
+#if SFML_VERSION_MAJOR >= 3
+        if (!t.tex.resize(sf::Vector2u{unsigned(t.w), unsigned(t.h)})) std::cerr << "Failed to create map texture\n";
+#else
+        if (!t.tex.create(unsigned(t.w), unsigned(t.h))) std::cerr << "Failed to create map texture\n";
+#endif
+      }
+    }
+    upload(0, 0, w_, h_);
+  }
+
+  // Re-upload cells [x0, x1) x [y0, y1) into every tile they overlap.
+  void upload(int x0, int y0, int x1, int y1) {
+    for (Tile& t : tiles_) {
+      int ax = std::max(x0, t.x0), ay = std::max(y0, t.y0);
+      int bx = std::min(x1, t.x0 + t.w), by = std::min(y1, t.y0 + t.h);
+      if (ax >= bx || ay >= by) continue;
+      const int rw = bx - ax, rh = by - ay;
+      pixels_.resize(size_t(rw) * size_t(rh) * 4);
+      uint8_t* px = pixels_.data();
+      for (int y = ay; y < by; ++y) {
+        const uint8_t* row = &snap_[size_t(y) * size_t(w_)];
+        for (int x = ax; x < bx; ++x, px += 4) {
+          uint8_t c = row[x] ? 0 : 255; // black = obstacle, white = free
+          px[0] = px[1] = px[2] = c; px[3] = 255;
+        }
+      }
+#if SFML_VERSION_MAJOR >= 3
+      t.tex.update(pixels_.data(), sf::Vector2u{unsigned(rw), unsigned(rh)},
+                   sf::Vector2u{unsigned(ax - t.x0), unsigned(ay - t.y0)});
+#else
+      t.tex.update(pixels_.data(), unsigned(rw), unsigned(rh), unsigned(ax - t.x0), unsigned(ay - t.y0));
+#endif
+    }
+  }
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Open lists for astar::BasicPlanner. All of them store 8-byte entries (f and
+// the cell index) and share one interface:
+//   reset(cells)  the map size changed (cells = w * h)
+//   clear()       start a new query (O(1) or O(buckets))
+//   push(id, f)   insert cell `id`, or lower its key if already queued
+//   pop()         remove and return a cell with minimal f
+//   topKey()      smallest queued f (not empty)
+//   empty(), size()
+// pop() may return a cell that was already expanded when the list keeps
+// duplicates instead of updating keys; the planner skips those.
+namespace astar {
+
+template <class Key>
+struct BasicOpenEntry {
+  Key f;
+  int32_t id;
+};
+using OpenEntry = BasicOpenEntry<float>;
+static_assert(sizeof(OpenEntry) == 8, "open-list entries should stay 8 bytes");
+
+// Binary heap with lazy deletion: an improved cell is pushed again and the
+// stale entry is discarded when it surfaces. Simple, but on dense maps the
+// heap holds several entries per frontier cell.
+class LazyHeap {
+public:
+  void reset(size_t) {}
+  void clear() { heap_.clear(); }
+  bool empty() const { return heap_.empty(); }
+  size_t size() const { return heap_.size(); }
+
+  float topKey() const { return heap_.front().f; }
+
+  void push(int id, float f) { heap_.push_back({f, id}); std::push_heap(heap_.begin(), heap_.end(), greater); }
+
+  int pop() {
+    std::pop_heap(heap_.begin(), heap_.end(), greater);
+    int id = heap_.back().id;
+    heap_.pop_back();
+    return id;
+  }
+
+private:
+  std::vector<OpenEntry> heap_;
+  static bool greater(const OpenEntry& a, const OpenEntry& b) { return a.f > b.f; }
+};
+
+// Indexed 4-ary min-heap with decrease-key: at most one entry per cell, and
+// the shallower tree halves the levels a sift-down visits. Per-cell heap
+// positions are generation-stamped like the planner's own arrays. `Key` is
+// float for the planners here; astar::StaticPlanner also keys it on
+// fixed-point integer costs (static_astar.hpp).
+template <class Key = float>
+class BasicIndexedHeap4 {
+  using Entry = BasicOpenEntry<Key>;
+
+public:
+  void reset(size_t cells) {
+    pos_.assign(cells, 0);
+    stamp_.assign(cells, 0);
+    gen_ = 0;
+  }
+
+  void clear() {
+    heap_.clear();
+    if (++gen_ == 0) {
+      std::fill(stamp_.begin(), stamp_.end(), 0u);
+      gen_ = 1;
+    }
+  }
+
+  bool empty() const { return heap_.empty(); }
+  size_t size() const { return heap_.size(); }
+  Key topKey() const { return heap_[0].f; }
+
+  void push(int id, Key f) {
+    if (stamp_[size_t(id)] == gen_ && pos_[size_t(id)] != kPopped) {
+      uint32_t i = pos_[size_t(id)];
+      Key old = heap_[i].f;
+      heap_[i].f = f;
+      if (f < old) siftUp(i);
+      else siftDown(i);
+      return;
+    }
+    stamp_[size_t(id)] = gen_;
+    heap_.push_back({f, id});
+    siftUp(uint32_t(heap_.size() - 1));
+  }
+
+  int pop() {
+    int id = heap_[0].id;
+    pos_[size_t(id)] = kPopped;
+    Entry last = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty()) {
+      heap_[0] = last;
+      siftDown(0);
+    }
+    return id;
+  }
+
+private:
+  static constexpr uint32_t kPopped = 0xffffffffu;
+  std::vector<Entry> heap_;
+  std::vector<uint32_t> pos_;   // index in heap_, or kPopped
+  std::vector<uint32_t> stamp_; // generation in which pos_ was written
+  uint32_t gen_ = 0;
+
+  void place(uint32_t i, const Entry& e) {
+    heap_[i] = e;
+    pos_[size_t(e.id)] = i;
+  }
+
+  void siftUp(uint32_t i) {
+    Entry e = heap_[i];
+    while (i > 0) {
+      uint32_t p = (i - 1) / 4;
+      if (!(e.f < heap_[p].f)) break;
+      place(i, heap_[p]);
+      i = p;
+    }
+    place(i, e);
+  }
+
+  void siftDown(uint32_t i) {
+    Entry e = heap_[i];
+    const uint32_t n = uint32_t(heap_.size());
+    for (;;) {
+      uint32_t c = 4 * i + 1;
+      if (c >= n) break;
+      uint32_t best = c;
+      uint32_t end = std::min(n, c + 4);
+      for (uint32_t k = c + 1; k < end; ++k)
+        if (heap_[k].f < heap_[best].f) best = k;
+      if (!(heap_[best].f < e.f)) break;
+      place(i, heap_[best]);
+      i = best;
+    }
+    place(i, e);
+  }
+};
+
+using IndexedHeap4 = BasicIndexedHeap4<>;
+
+// Ring of f-buckets of fixed width. With the Euclidean heuristic the keys A*
+// pushes never fall below the last popped key, and on the 8-connected grid
+// they exceed it by at most twice the largest step (2 * sqrt(2) for plain
+// maps), so a short ring covers the whole open list and each bucket holds a
+// handful of entries kept as a tiny binary heap. Pops are exact (the lowest
+// non-empty bucket holds the minimum); the ring doubles if a key lands past
+// its end, e.g. under a costmap's cell costs. Duplicates are kept like
+// LazyHeap, but each push or pop only touches one small bucket.
+class BucketQueue {
+public:
+  explicit BucketQueue(float width = 1.f / 32, size_t buckets = 128)
+      : inv_(1.f / (width > 0.f ? width : 1.f / 32)) {
+    size_t n = 2;
+    while (n < buckets) n *= 2;
+    ring_.resize(n);
+  }
+
+  void reset(size_t) {}
+
+  void clear() {
+    for (auto& b : ring_) b.clear();
+    count_ = 0;
+  }
+
+  bool empty() const { return count_ == 0; }
+  size_t size() const { return count_; }
+
+  float topKey() const {
+    size_t i = cur_;
+    while (ring_[i].empty()) i = (i + 1) & (ring_.size() - 1);
+    return ring_[i][0].f;
+  }
+
+  void push(int id, float f) {
+    const long long key = (long long)std::floor(f * inv_);
+    if (count_ == 0) { base_ = key; cur_ = 0; }
+    long long k = std::max(0LL, key - base_); // rounding can dip just below the base
+    if (size_t(k) >= ring_.size()) grow(size_t(k) + 1);
+    auto& b = ring_[(cur_ + size_t(k)) & (ring_.size() - 1)];
+    b.push_back({f, id});
+    std::push_heap(b.begin(), b.end(), greater);
+    ++count_;
+  }
+
+  int pop() {
+    while (ring_[cur_].empty()) {
+      cur_ = (cur_ + 1) & (ring_.size() - 1);
+      ++base_;
+    }
+    auto& b = ring_[cur_];
+    std::pop_heap(b.begin(), b.end(), greater);
+    int id = b.back().id;
+    b.pop_back();
+    --count_;
+    return id;
+  }
+
+private:
+  float inv_; // 1 / bucket width
+  std::vector<std::vector<OpenEntry>> ring_; // power-of-two size
+  size_t cur_ = 0;     // ring slot of key base_
+  long long base_ = 0; // key (floor(f / width)) of the lowest slot
+  size_t count_ = 0;
+
+  static bool greater(const OpenEntry& a, const OpenEntry& b) { return a.f > b.f; }
+
+  // Re-lay the ring with at least `need` slots, lowest slot first.
+  void grow(size_t need) {
+    size_t n = ring_.size();
+    while (n < need) n *= 2;
+    std::vector<std::vector<OpenEntry>> next(n);
+    for (size_t i = 0; i < ring_.size(); ++i) next[i].swap(ring_[(cur_ + i) & (ring_.size() - 1)]);
+    ring_.swap(next);
+    cur_ = 0;
+  }
+};
+
+} // namespace astar
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "geometry.hpp"
+#include "map.hpp"
+#include "profiler.hpp"
+#include "theta_star.hpp"
+
+// Path post-processing: grid path -> collinear-point removal -> simplification
+// (line-of-sight shortcutting or Ramer-Douglas-Peucker) -> Chaikin smoothing.
+// All stages work in buffers owned by the Pipeline, and the result is written
+// into a caller-provided vector, so once the buffers have grown to the
+// largest path seen, run() performs no heap allocations.
+namespace postproc {
+
+enum class Simplify { None, LineOfSight, RDP };
+
+struct Options {
+  bool removeCollinear = true;
+  Simplify simplify = Simplify::LineOfSight;
+  float rdpEpsilon = 0.5f;  // max deviation in cells for RDP
+  int chaikinIters = 2;
+  size_t maxVertices = 4096; // smoothing stops before exceeding this
+};
+
+// True if the straight segment a -> b (cell coordinates, cell (x, y) spans
+// [x, x+1) x [y, y+1)) only crosses free cells. Grid traversal in which corner
+// crossings (within rounding) step diagonally, like theta::lineOfSight, so
+// centre-to-centre segments get the same answer from both.
+template <class Grid>
+bool segmentFree(const Grid& map, Vec2f a, Vec2f b) {
+  int x = int(std::floor(a.x)), y = int(std::floor(a.y));
+  const int ex = int(std::floor(b.x)), ey = int(std::floor(b.y));
+  if (!map.isFree(x, y)) return false;
+  // Doubles keep rounding far below the gap between distinct border
+  // crossings, so a small tolerance reliably detects corners
+  const double dx = double(b.x) - a.x, dy = double(b.y) - a.y;
+  const int sx = dx > 0 ? 1 : -1, sy = dy > 0 ? 1 : -1;
+  const double inf = std::numeric_limits<double>::infinity();
+  const double tdx = dx != 0 ? 1.0 / std::fabs(dx) : inf;
+  const double tdy = dy != 0 ? 1.0 / std::fabs(dy) : inf;
+  double tx = dx != 0 ? (sx > 0 ? x + 1.0 - a.x : a.x - double(x)) * tdx : inf;
+  double ty = dy != 0 ? (sy > 0 ? y + 1.0 - a.y : a.y - double(y)) * tdy : inf;
+  const double tol = 1e-9;
+  for (int guard = std::abs(ex - x) + std::abs(ey - y); guard > 0 && (x != ex || y != ey); --guard) {
+    if (tx + tol < ty) { x += sx; tx += tdx; }
+    else if (ty + tol < tx) { y += sy; ty += tdy; }
+    else { x += sx; y += sy; tx += tdx; ty += tdy; --guard; }
+    if (!map.isFree(x, y)) return false;
+  }
+  return true;
+}
+
+class Pipeline {
+public:
+  Options opts;
+
+  Pipeline() = default;
+  explicit Pipeline(const Options& o) : opts(o) {}
+
+  // Post-process `path` into `out` (overwritten). `map` enables the
+  // line-of-sight stages; with nullptr, LineOfSight simplification is skipped,
+  // RDP ignores obstacles and smoothing is not validated.
+  template <class Grid>
+  void run(const Grid* map, const std::vector<Vec2i>& path, std::vector<Vec2f>& out) {
+    PP_PROF_SCOPE("post.run");
+    out.clear();
+    if (path.empty()) return;
+
+    pts_.assign(path.begin(), path.end());
+    if (opts.removeCollinear) removeCollinear();
+    if (opts.simplify == Simplify::LineOfSight && map) shortcut(*map);
+    else if (opts.simplify == Simplify::RDP) rdp(map);
+
+    // Chaikin doubles the vertex count per iteration; bound it up front
+    int iters = std::max(0, opts.chaikinIters);
+    while (iters > 0 && (pts_.size() << iters) > opts.maxVertices) --iters;
+
+    cur_.clear();
+    for (const Vec2i& p : pts_) cur_.push_back({p.x + 0.5f, p.y + 0.5f});
+    for (int it = 0; it < iters && cur_.size() >= 3; ++it) {
+      chaikinStep(cur_, tmp_);
+      // Corner cuts of long segments can clip obstacles: keep the last valid level
+      if (map && !polylineFree(*map, tmp_)) break;
+      cur_.swap(tmp_);
+    }
+    // Copy rather than swap so `out` keeps its own capacity across calls
+    out.assign(cur_.begin(), cur_.end());
+  }
+
+  void run(const std::vector<Vec2i>& path, std::vector<Vec2f>& out) {
+    run(static_cast<const GridMap*>(nullptr), path, out);
+  }
+
+private:
+  std::vector<Vec2i> pts_, keep_;
+  std::vector<Vec2f> cur_, tmp_;
+  std::vector<std::pair<size_t, size_t>> stack_;
+  std::vector<uint8_t> mark_;
+
+  // Drop vertices lying on the straight line through their neighbours.
+  void removeCollinear() {
+    if (pts_.size() < 3) return;
+    size_t n = 1;
+    for (size_t i = 1; i + 1 < pts_.size(); ++i) {
+      Vec2i a = pts_[n - 1], b = pts_[i], c = pts_[i + 1];
+      long long cross = (long long)(b.x - a.x) * (c.y - b.y) - (long long)(b.y - a.y) * (c.x - b.x);
+      long long dot = (long long)(b.x - a.x) * (c.x - b.x) + (long long)(b.y - a.y) * (c.y - b.y);
+      if (cross == 0 && dot > 0) continue;
+      pts_[n++] = b;
+    }
+    pts_[n++] = pts_.back();
+    pts_.resize(n);
+  }
+
+  // Greedy string pulling: from each kept vertex jump to the farthest later
+  // vertex still in line of sight.
+  template <class Grid>
+  void shortcut(const Grid& map) {
+    if (pts_.size() < 3) return;
+    keep_.clear();
+    keep_.push_back(pts_.front());
+    size_t i = 0;
+    while (i + 1 < pts_.size()) {
+      size_t j = i + 1;
+      while (j + 1 < pts_.size() && theta::lineOfSight(map, pts_[i], pts_[j + 1])) ++j;
+      keep_.push_back(pts_[j]);
+      i = j;
+    }
+    pts_.swap(keep_);
+  }
+
+  // Iterative Ramer-Douglas-Peucker; with a map, a span is only collapsed if
+  // its chord is also in line of sight.
+  template <class Grid>
+  void rdp(const Grid* map) {
+    const size_t n = pts_.size();
+    if (n < 3) return;
+    mark_.assign(n, 0);
+    mark_[0] = mark_[n - 1] = 1;
+    stack_.clear();
+    stack_.push_back({0, n - 1});
+    const float eps2 = opts.rdpEpsilon * opts.rdpEpsilon;
+    while (!stack_.empty()) {
+      auto [a, b] = stack_.back();
+      stack_.pop_back();
+      if (b <= a + 1) continue;
+      const Vec2i A = pts_[a], B = pts_[b];
+      const float vx = float(B.x - A.x), vy = float(B.y - A.y);
+      const float len2 = std::max(1e-6f, vx * vx + vy * vy);
+      size_t worst = a; float worstD2 = -1.f;
+      for (size_t k = a + 1; k < b; ++k) {
+        float cx = float(pts_[k].x - A.x), cy = float(pts_[k].y - A.y);
+        float cr = vx * cy - vy * cx;
+        float d2 = cr * cr / len2;
+        if (d2 > worstD2) { worstD2 = d2; worst = k; }
+      }
+      if (worstD2 <= eps2 && (!map || theta::lineOfSight(*map, A, B))) continue;
+      mark_[worst] = 1;
+      stack_.push_back({a, worst});
+      stack_.push_back({worst, b});
+    }
+    size_t m = 0;
+    for (size_t k = 0; k < n; ++k)
+      if (mark_[k]) pts_[m++] = pts_[k];
+    pts_.resize(m);
+  }
+
+  static void chaikinStep(const std::vector<Vec2f>& cur, std::vector<Vec2f>& next) {
+    next.clear();
+    next.push_back(cur.front());
+    for (size_t i = 0; i + 1 < cur.size(); ++i) {
+      Vec2f P = cur[i], Q = cur[i + 1];
+      next.push_back(0.75f * P + 0.25f * Q); // keep closer to original
+      next.push_back(0.25f * P + 0.75f * Q);
+    }
+    next.push_back(cur.back());
+  }
+
+  template <class Grid>
+  static bool polylineFree(const Grid& map, const std::vector<Vec2f>& p) {
+    for (size_t i = 1; i < p.size(); ++i)
+      if (!segmentFree(map, p[i - 1], p[i])) return false;
+    return true;
+  }
+};
+
+} // namespace postproc
@@ -0,0 +1,428 @@
+// Headless batch planner: reads (map, start, goal) queries from a file or
+// stdin and writes paths plus per-query timings to stdout. Links only the
+// planning core, so it runs on display-less hosts without SFML.
+//
+// Input (one directive per line, '#' starts a comment):
+//   map demo W H
+//   map open W H
+//   map random W H RECTS MIN MAX SEED
+//   map grid W H            followed by H rows of '.' (free) / '#' (blocked)
+//   map tiled PATH [X Y W H] window of a tiled map file (map_convert output)
+//   cell X Y 0|1            edit one cell of the current map
+//   rect X Y W H 0|1        set a block of cells in one edit transaction
+//   query SX SY GX GY
+//
+// Output (one line per query):
+//   <id> ok|fail <plan_ms> <cells> <length> x,y x,y ...
+//
+// --engine astar|astar-bits|jps|dstar|hpa selects the planner. All but hpa
+// return optimal 8-connected paths; astar-bits runs A* on the bit-packed
+// BitGrid copy of the map, dstar (D* Lite) reuses its search tree across `cell`
+// edits and start changes as long as the goal stays the same, and hpa (HPA*)
+// trades a few percent of path length for much faster queries on large maps.
+// theta and lazy-theta (Theta* / Lazy Theta*) plan any-angle paths: the
+// output lists only the waypoints, and the length is the straight-line sum.
+// bidir and bidir-mt run bidirectional A* (optimal, same costs as astar),
+// bidir-mt with the two frontiers on two threads. flow builds one
+// goal-rooted distance field per goal and answers every query to that goal
+// by descending it (optimal; the build is charged to the first query).
+// static runs astar::StaticPlanner (static_astar.hpp) with the policies
+// picked by --neighbors 4|8 (default 8), --heuristic
+// octile|euclid|manhattan|zero (default octile) and --cost float|fixed
+// (default float); 4-neighbour paths only move along rows and columns.
+// lattice runs the state-lattice planner (lattice.hpp) for a robot with a
+// minimum turning radius of --turn-radius R cells (default 3), starting
+// with heading +x and stopping at the goal with any heading. The output
+// lists the cells where its motion primitives start and end, and the length
+// is that of the driven curve.
+//
+// --threads N (astar only) plans the queries between two map/cell directives
+// as one batch on N worker threads; output order is unchanged.
+//
+// --open lazy|heap4|bucket (astar, astar-bits and costmap runs) picks A*'s
+// open list: the lazy-deletion binary heap (default), the indexed 4-ary heap
+// with decrease-key or the f-bucket queue (open_list.hpp). Paths are optimal
+// with all three; other engines reject --open.
+//
+// --alt N (astar, astar-bits and costmap runs, one thread) adds the ALT
+// landmark heuristic with N landmarks (landmarks.hpp), rebuilt before the
+// first query after a map or cell directive. --alt-cache DIR keeps the
+// landmark tables in DIR keyed by a hash of the occupancy, so a rerun on the
+// same maps loads them instead of recomputing.
+//
+// --inflate R / --clearance D / --clearance-weight W (astar only) plan on a
+// costmap::Costmap: cells within R of an obstacle are blocked and cells
+// closer than D cost up to 1 + W times more to enter. Lengths are still
+// reported in plain grid steps.
+//
+// In builds with PP_PROFILE=1 a per-stage summary (see profiler.hpp) follows
+// the totals on stderr, and --trace FILE writes a Chrome trace of the run.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "a_star.hpp"
+#include "batch.hpp"
+#include "bidir.hpp"
+#include "bitgrid.hpp"
+#include "costmap.hpp"
+#include "dstar_lite.hpp"
+#include "flow_field.hpp"
+#include "hpa.hpp"
+#include "jps.hpp"
+#include "landmarks.hpp"
+#include "lattice.hpp"
+#include "map.hpp"
+#include "profiler.hpp"
+#include "static_astar.hpp"
+#include "theta_star.hpp"
+#include "tiled_map.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+static bool readGrid(std::istream& in, GridMap& map, int W, int H, long long& lineNo) {
+  map.w = W; map.h = H;
+  map.occ.assign(W * H, 0);
+  map.replaced(); // the rows below are written directly
+  std::string row;
+  for (int y = 0; y < H; ++y) {
+    if (!std::getline(in, row)) return false;
+    ++lineNo;
+    for (int x = 0; x < W && x < static_cast<int>(row.size()); ++x)
+      map.occ[y * W + x] = (row[x] == '#') ? 1 : 0;
+  }
+  return true;
+}
+
+// Euclidean length through the cell centres: 1 or sqrt(2) per grid step,
+// straight-line length per segment for any-angle waypoint paths.
+static float gridLength(const std::vector<Vec2i>& p) {
+  float L = 0.f;
+  for (size_t i = 1; i < p.size(); ++i) L += astar::heuristic(p[i].x, p[i].y, p[i-1].x, p[i-1].y);
+  return L;
+}
+
+int main(int argc, char** argv) {
+  std::string inPath;
+  bool printPaths = true;
+  std::string engine = "astar";
+  int threads = 1;
+  float inflate = 0.f, clearance = 0.f, clearanceWeight = 0.f;
+  std::string tracePath;
+  std::string openList = "lazy";
+  int altCount = 0;
+  std::string altCache;
+  int neighbors = 8;
+  std::string heuristicName = "octile", costName = "float";
+  float turnRadius = 0.f;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--no-paths") { printPaths = false; continue; }
+    if (a.rfind("--engine=", 0) == 0) { engine = a.substr(9); continue; }
+    if (a == "--engine" && i + 1 < argc) { engine = argv[++i]; continue; }
+    if (a.rfind("--threads=", 0) == 0) { threads = std::max(1, std::atoi(a.c_str() + 10)); continue; }
+    if (a == "--threads" && i + 1 < argc) { threads = std::max(1, std::atoi(argv[++i])); continue; }
+    if (a == "--inflate" && i + 1 < argc) { inflate = float(std::atof(argv[++i])); continue; }
+    if (a == "--clearance" && i + 1 < argc) { clearance = float(std::atof(argv[++i])); continue; }
+    if (a == "--clearance-weight" && i + 1 < argc) { clearanceWeight = float(std::atof(argv[++i])); continue; }
+    if (a == "--trace" && i + 1 < argc) { tracePath = argv[++i]; continue; }
+    if (a.rfind("--open=", 0) == 0) { openList = a.substr(7); continue; }
+    if (a == "--open" && i + 1 < argc) { openList = argv[++i]; continue; }
+    if (a == "--alt" && i + 1 < argc) { altCount = std::max(0, std::atoi(argv[++i])); continue; }
+    if (a == "--alt-cache" && i + 1 < argc) { altCache = argv[++i]; continue; }
+    if (a == "--neighbors" && i + 1 < argc) { neighbors = std::atoi(argv[++i]); continue; }
+    if (a == "--heuristic" && i + 1 < argc) { heuristicName = argv[++i]; continue; }
+    if (a == "--cost" && i + 1 < argc) { costName = argv[++i]; continue; }
+    if (a == "--turn-radius" && i + 1 < argc) { turnRadius = float(std::atof(argv[++i])); continue; }
+    if (a == "-h" || a == "--help") {
+      std::cout << "usage: plan_batch [--no-paths] [--engine astar|astar-bits|jps|dstar|hpa|theta|lazy-theta|bidir|bidir-mt|flow|static|lattice]\n"
+                   "                  [--neighbors 4|8] [--heuristic octile|euclid|manhattan|zero] [--cost float|fixed]\n"
+                   "                  [--turn-radius R]\n"
+                   "                  [--threads N] [--open lazy|heap4|bucket] [--alt N] [--alt-cache DIR]"
+                   " [--inflate R] [--clearance D] [--clearance-weight W] [--trace FILE] [queries.txt | -]\n";
+      return 0;
+    }
+    if (a.size() > 1 && a[0] == '-') { // unknown, or a flag missing its value
+      std::cerr << "Unknown flag or missing value: '" << a << "'; see --help\n";
+      return 1;
+    }
+    if (inPath.empty()) inPath = a;
+  }
+
+  if (engine != "astar" && engine != "astar-bits" && engine != "jps" && engine != "dstar" && engine != "hpa" &&
+      engine != "theta" && engine != "lazy-theta" && engine != "bidir" && engine != "bidir-mt" &&
+      engine != "flow" && engine != "static" && engine != "lattice") {
+    std::cerr << "Unknown engine '" << engine << "'\n";
+    return 1;
+  }
+  const bool useJPS = engine == "jps", useDStar = engine == "dstar", useBits = engine == "astar-bits";
+  const bool useHPA = engine == "hpa";
+  const bool useTheta = engine == "theta" || engine == "lazy-theta";
+  const bool useBidir = engine == "bidir" || engine == "bidir-mt";
+  const bool useFlow = engine == "flow";
+  const bool useStatic = engine == "static";
+  const bool useLattice = engine == "lattice";
+  if (!useStatic && (neighbors != 8 || heuristicName != "octile" || costName != "float")) {
+    std::cerr << "--neighbors/--heuristic/--cost are only supported with --engine static\n";
+    return 1;
+  }
+  if (!useLattice && turnRadius > 0.f) {
+    std::cerr << "--turn-radius is only supported with --engine lattice\n";
+    return 1;
+  }
+  if (threads > 1 && engine != "astar") {
+    std::cerr << "--threads is only supported with --engine astar\n";
+    return 1;
+  }
+  if (openList != "lazy" && openList != "heap4" && openList != "bucket") {
+    std::cerr << "Unknown open list '" << openList << "'\n";
+    return 1;
+  }
+  if (openList != "lazy" && ((engine != "astar" && engine != "astar-bits") || threads > 1)) {
+    std::cerr << "--open is only supported with --engine astar|astar-bits and one thread\n";
+    return 1;
+  }
+  if (altCount > 0 && ((engine != "astar" && engine != "astar-bits") || threads > 1)) {
+    std::cerr << "--alt is only supported with --engine astar|astar-bits and one thread\n";
+    return 1;
+  }
+  const bool useCostmap = inflate > 0.f || (clearance > 0.f && clearanceWeight > 0.f);
+  if (useCostmap && (engine != "astar" || threads > 1)) {
+    std::cerr << "--inflate/--clearance are only supported with --engine astar and one thread\n";
+    return 1;
+  }
+
+  std::ifstream file;
+  std::istream* in = &std::cin;
+  if (!inPath.empty() && inPath != "-") {
+    file.open(inPath);
+    if (!file) { std::cerr << "Failed to open '" << inPath << "'\n"; return 1; }
+    in = &file;
+  }
+
+  std::ios::sync_with_stdio(false);
+  std::cout << std::fixed << std::setprecision(3);
+
+  GridMap map;
+  BitGrid bitGrid;
+  costmap::Costmap costLayer(inflate, clearance, clearanceWeight);
+  astar::Planner planner;
+  astar::BasicPlanner<astar::IndexedHeap4> heapPlanner;
+  astar::BasicPlanner<astar::BucketQueue> bucketPlanner;
+  jps::Planner jpsPlanner;
+  dstar::Planner dstarPlanner;
+  hpa::Planner hpaPlanner;
+  theta::Planner thetaPlanner(engine == "lazy-theta");
+  bidir::Planner bidirPlanner(engine == "bidir-mt");
+  flow::FlowField flowField;
+  lattice::Planner latticePlanner(turnRadius > 0.f ? turnRadius : 3.f);
+  std::vector<Vec2f> curve;
+  std::vector<Vec2i> path;
+  // The StaticPlanner instantiation picked by --neighbors/--heuristic/--cost
+  std::function<void(Vec2i, Vec2i)> planStatic;
+  if (useStatic && !astar::selectStatic(neighbors, heuristicName, costName, [&](auto policies) {
+        auto planner = std::make_shared<typename decltype(policies)::Planner>();
+        planStatic = [planner, &map, &path](Vec2i s, Vec2i g) { planner->plan(map, s, g, path); };
+      })) {
+    std::cerr << "Unknown --neighbors/--heuristic/--cost combination\n";
+    return 1;
+  }
+  // The lattice path's primitive endpoints; its poses stay in `curve`
+  auto planLattice = [&](Vec2i s, Vec2i g) {
+    if (latticePlanner.plan(map, s, 0.f, g, curve)) path = latticePlanner.lastCells();
+    else path.clear();
+  };
+  alt::Landmarks landmarks;
+  bool landmarksStale = true;
+  // A* on any grid view with the selected open list (and landmark heuristic)
+  auto planAStar = [&](const auto& grid, Vec2i s, Vec2i g) {
+    auto run = [&](const auto& view) {
+      if (openList == "heap4") heapPlanner.plan(view, s, g, path);
+      else if (openList == "bucket") bucketPlanner.plan(view, s, g, path);
+      else planner.plan(view, s, g, path);
+    };
+    if (altCount > 0) run(alt::View<std::decay_t<decltype(grid)>>(grid, landmarks));
+    else run(grid);
+  };
+  auto refreshLandmarks = [&]() {
+    auto t0 = Clock::now();
+    bool cached = false;
+    if (altCache.empty()) landmarks.build(map, altCount);
+    else landmarks.loadOrBuild(map, altCount, altCache, &cached);
+    landmarksStale = false;
+    std::cerr << "landmarks=" << landmarks.count() << (cached ? " loaded_ms=" : " built_ms=")
+              << std::chrono::duration<double, std::milli>(Clock::now() - t0).count() << "\n";
+  };
+  bool haveMap = false;
+  long long lineNo = 0, nQueries = 0, nFound = 0;
+  double totalMs = 0.0;
+  std::string line;
+
+  // length < 0: measure p through the cell centres
+  auto emit = [&](const std::vector<Vec2i>& p, double ms, float length = -1.f) {
+    totalMs += ms;
+    bool ok = !p.empty();
+    if (ok) ++nFound;
+    std::cout << nQueries++ << (ok ? " ok " : " fail ") << ms << " " << p.size() << " "
+              << (length < 0.f ? gridLength(p) : length);
+    if (printPaths)
+      for (auto& c : p) std::cout << " " << c.x << "," << c.y;
+    std::cout << "\n";
+  };
+
+  // Multi-threaded mode: queries are buffered until the map is about to change
+  std::unique_ptr<batch::BatchPlanner<>> pool;
+  if (threads > 1) pool = std::make_unique<batch::BatchPlanner<>>(threads);
+  std::vector<batch::Query> pending;
+  std::vector<batch::Result> results;
+  auto flush = [&]() {
+    if (!pool || pending.empty()) return;
+    pool->run(map, pending, results);
+    for (auto& r : results) emit(r.path, r.ms);
+    pending.clear();
+  };
+
+  if (!tracePath.empty()) {
+    if (prof::enabled()) prof::Registry::get().startTrace();
+    else std::cerr << "--trace needs a build with -DENABLE_PROFILING=ON, ignoring\n";
+  }
+  PP_PROF_THREAD("main");
+  auto wall0 = Clock::now();
+
+  while (std::getline(*in, line)) {
+    ++lineNo;
+    std::istringstream ls(line);
+    std::string cmd;
+    if (!(ls >> cmd) || cmd[0] == '#') continue;
+
+    if (cmd == "map") {
+      flush();
+      haveMap = false; // queries fail until a map loads, rather than run on the old one
+      std::string kind; int W = 0, H = 0;
+      if ((ls >> kind) && kind == "tiled") {
+        std::string path; int X = 0, Y = 0;
+        W = H = -1;
+        ls >> path >> X >> Y >> W >> H;
+        tiles::TiledMap tiled;
+        haveMap = tiled.open(path) && tiled.extract(map, X, Y, W, H);
+        if (!haveMap) std::cerr << "line " << lineNo << ": cannot load tiled map '" << path << "'\n";
+      } else if (!(ls >> W >> H) || W < 3 || H < 3) {
+        std::cerr << "line " << lineNo << ": bad map directive\n";
+        continue;
+      } else if (kind == "demo") { map.makeDemo(W, H); haveMap = true; }
+      else if (kind == "open") { map.makeOpen(W, H); haveMap = true; }
+      else if (kind == "random") {
+        int rects = 18, mn = 3, mx = 12; unsigned seed = 12345u;
+        ls >> rects >> mn >> mx >> seed;
+        map.makeRandom(W, H, rects, mn, std::max(mn, mx), seed);
+        haveMap = true;
+      } else if (kind == "grid") {
+        haveMap = readGrid(*in, map, W, H, lineNo);
+        if (!haveMap) std::cerr << "line " << lineNo << ": truncated grid\n";
+      } else {
+        std::cerr << "line " << lineNo << ": unknown map kind '" << kind << "'\n";
+      }
+      if (haveMap && useJPS) jpsPlanner.sync(map);
+      if (haveMap && useBits) bitGrid.build(map);
+      if (haveMap && useHPA) hpaPlanner.build(map);
+      if (haveMap && useDStar) dstarPlanner.sync(map);
+      if (haveMap && useCostmap) costLayer.build(map);
+      if (haveMap && useFlow) flowField.sync(map);
+      landmarksStale = true;
+      continue;
+    }
+
+    if (cmd == "cell") {
+      int x = 0, y = 0, v = 0;
+      if (!(ls >> x >> y >> v) || !haveMap || !map.inBounds(x, y)) {
+        std::cerr << "line " << lineNo << ": bad cell directive\n";
+        continue;
+      }
+      flush();
+      map.setOcc(x, y, static_cast<uint8_t>(v));
+      if (useJPS) jpsPlanner.syncCell(map, x, y);
+      if (useBits) bitGrid.syncCell(map, x, y);
+      if (useHPA) hpaPlanner.cellChanged(map, x, y);
+      if (useDStar) dstarPlanner.cellChanged(map, x, y);
+      if (useCostmap) costLayer.cellChanged(map, x, y);
+      if (useFlow) flowField.cellChanged(map, x, y);
+      landmarksStale = true;
+      continue;
+    }
+
+    if (cmd == "rect") {
+      int x0 = 0, y0 = 0, rw = 0, rh = 0, v = 0;
+      if (!(ls >> x0 >> y0 >> rw >> rh >> v) || !haveMap || rw < 1 || rh < 1) {
+        std::cerr << "line " << lineNo << ": bad rect directive\n";
+        continue;
+      }
+      flush();
+      {
+        GridMap::Edit edit(map); // one journal entry for the whole block
+        for (int y = y0; y < y0 + rh; ++y)
+          for (int x = x0; x < x0 + rw; ++x) map.setOcc(x, y, static_cast<uint8_t>(v));
+      }
+      // Each engine catches up from the journal: only the block is rescanned
+      if (useJPS) jpsPlanner.sync(map);
+      if (useBits)
+        for (int y = y0; y < y0 + rh; ++y)
+          for (int x = x0; x < x0 + rw; ++x) bitGrid.syncCell(map, x, y);
+      if (useHPA) hpaPlanner.sync(map);
+      if (useDStar) dstarPlanner.sync(map);
+      if (useCostmap) costLayer.sync(map);
+      if (useFlow) flowField.sync(map);
+      landmarksStale = true;
+      continue;
+    }
+
+    if (cmd == "query") {
+      Vec2i s, g;
+      if (!(ls >> s.x >> s.y >> g.x >> g.y)) {
+        std::cerr << "line " << lineNo << ": bad query directive\n";
+        continue;
+      }
+      if (!haveMap) { std::cerr << "line " << lineNo << ": query before map\n"; continue; }
+      if (pool) { pending.push_back({s, g}); continue; }
+      if (altCount > 0 && landmarksStale) refreshLandmarks(); // not counted as query time
+      auto t0 = Clock::now();
+      if (useJPS) jpsPlanner.plan(map, s, g, path);
+      else if (useDStar) dstarPlanner.plan(map, s, g, path);
+      else if (useBits) planAStar(bitGrid, s, g);
+      else if (useHPA) hpaPlanner.plan(map, s, g, path);
+      else if (useTheta) thetaPlanner.plan(map, s, g, path);
+      else if (useBidir) bidirPlanner.plan(map, s, g, path);
+      else if (useFlow) flowField.plan(map, s, g, path);
+      else if (useStatic) planStatic(s, g);
+      else if (useLattice) planLattice(s, g);
+      else if (useCostmap) planAStar(costLayer, s, g);
+      else planAStar(map, s, g);
+      auto t1 = Clock::now();
+      emit(path, std::chrono::duration<double, std::milli>(t1 - t0).count(),
+           useLattice ? latticePlanner.lastLength() : -1.f);
+      continue;
+    }
+
+    std::cerr << "line " << lineNo << ": unknown directive '" << cmd << "'\n";
+  }
+  flush();
+
+  double wallMs = std::chrono::duration<double, std::milli>(Clock::now() - wall0).count();
+  std::cerr << "queries=" << nQueries << " found=" << nFound
+            << " plan_ms=" << totalMs << " wall_ms=" << wallMs
+            << " qps=" << (wallMs > 0.0 ? 1000.0 * nQueries / wallMs : 0.0) << "\n";
+  if (prof::enabled()) {
+    prof::Registry::get().report(std::cerr, wallMs / 1000.0);
+    if (!tracePath.empty() && !prof::Registry::get().writeChromeTrace(tracePath)) return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,329 @@
+// Planner benchmark on makeRandom maps. For each map it draws random free
+// start/goal pairs, runs plain A* as the reference and reports per-engine
+// mean plan time and path-length suboptimality (cost / A* cost). Any-angle
+// engines (Theta*) can beat A*, so their ratio drops below 1. A* also runs
+// with the indexed 4-ary heap and the bucket queue open lists (open_list.hpp);
+// their ratio must stay 1 and the peak open-list sizes are compared.
+// Bidirectional A* (bidir, and bidir-mt on two threads) must also keep ratio
+// 1; its gain is reported separately for the longest tenth of the routes.
+// astar-alt is A* with the landmark heuristic (--landmarks N, default 8),
+// built once per map; its build time and expansions are reported.
+// astar-octile and astar-fixed are astar::StaticPlanner with the octile
+// heuristic on float and fixed-point costs (static_astar.hpp).
+// lattice is the state-lattice planner (lattice.hpp, turning radius 3,
+// starting with heading +x); it is reported on its own line because it can
+// fail where A* succeeds (no room to turn), and its length is that of the
+// driven curve.
+// Finally every map plans the same number of queries to one shared goal,
+// with A* per query and with one flow::FlowField build plus extractions.
+//
+//   plan_bench [--size WxH] [--rects N] [--min N] [--max N] [--seed N]
+//              [--maps N] [--queries N] [--cluster N] [--threads N]
+//              [--landmarks N]
+//
+// --threads N additionally replays each map's query set through
+// batch::BatchPlanner on 1 and N threads and reports throughput.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "a_star.hpp"
+#include "batch.hpp"
+#include "bidir.hpp"
+#include "flow_field.hpp"
+#include "hpa.hpp"
+#include "jps.hpp"
+#include "landmarks.hpp"
+#include "lattice.hpp"
+#include "map.hpp"
+#include "static_astar.hpp"
+#include "theta_star.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// Euclidean length through the cell centres: 1 or sqrt(2) per grid step,
+// straight-line length per segment for any-angle waypoint paths.
+static float gridLength(const std::vector<Vec2i>& p) {
+  float L = 0.f;
+  for (size_t i = 1; i < p.size(); ++i) L += astar::heuristic(p[i].x, p[i].y, p[i-1].x, p[i-1].y);
+  return L;
+}
+
+struct EngineStats {
+  const char* name;
+  double ms = 0.0;
+  double ratioSum = 0.0, ratioMax = 1.0;
+  long long n = 0, failed = 0;
+
+  void add(double t, const std::vector<Vec2i>& path, float refLen) {
+    ms += t; ++n;
+    if (path.empty()) { ++failed; return; }
+    double r = refLen > 0.f ? gridLength(path) / refLen : 1.0;
+    ratioSum += r;
+    ratioMax = std::max(ratioMax, r);
+  }
+};
+
+int main(int argc, char** argv) {
+  int W = 512, H = 512, rects = 400, rmin = 3, rmax = 16;
+  int maps = 3, queries = 200, cluster = 16, threads = 0, landmarkCount = 8;
+  unsigned seed = 12345u;
+
+  auto parseSize = [](const std::string& s, int& w, int& h) {
+    auto xpos = s.find('x');
+    if (xpos == std::string::npos) return;
+    w = std::max(3, std::atoi(s.substr(0, xpos).c_str()));
+    h = std::max(3, std::atoi(s.substr(xpos + 1).c_str()));
+  };
+  for (int i = 1; i < argc; i += 2) {
+    std::string a = argv[i];
+    if (a == "-h" || a == "--help") {
+      std::cout << "usage: plan_bench [--size WxH] [--rects N] [--min N] [--max N] [--seed N]\n"
+                   "                  [--maps N] [--queries N] [--cluster N] [--threads N]\n"
+                   "                  [--landmarks N]\n";
+      return 0;
+    }
+    if (i + 1 == argc) { std::cerr << "Missing value for flag '" << a << "'\n"; return 1; }
+    std::string v = argv[i + 1];
+    if (a == "--size") parseSize(v, W, H);
+    else if (a == "--rects") rects = std::max(0, std::atoi(v.c_str()));
+    else if (a == "--min") rmin = std::max(1, std::atoi(v.c_str()));
+    else if (a == "--max") rmax = std::max(rmin, std::atoi(v.c_str()));
+    else if (a == "--seed") seed = static_cast<unsigned>(std::strtoul(v.c_str(), nullptr, 10));
+    else if (a == "--maps") maps = std::max(1, std::atoi(v.c_str()));
+    else if (a == "--queries") queries = std::max(1, std::atoi(v.c_str()));
+    else if (a == "--cluster") cluster = std::max(4, std::atoi(v.c_str()));
+    else if (a == "--threads") threads = std::max(1, std::atoi(v.c_str()));
+    else if (a == "--landmarks") landmarkCount = std::max(1, std::atoi(v.c_str()));
+    else { std::cerr << "Unknown flag '" << a << "'\n"; return 1; }
+  }
+
+  astar::Planner astarPlanner;
+  astar::BasicPlanner<astar::IndexedHeap4> heapPlanner;
+  astar::BasicPlanner<astar::BucketQueue> bucketPlanner;
+  jps::Planner jpsPlanner;
+  hpa::Planner hpaPlanner(cluster);
+  theta::Planner thetaPlanner(true);
+  bidir::Planner bidirPlanner(false), bidirMtPlanner(true);
+  EngineStats sA{"astar"}, s4{"astar-heap4"}, sB{"astar-bucket"}, sJ{"jps"}, sH{"hpa"}, sT{"lazytheta"};
+  EngineStats sD{"bidir"}, sM{"bidir-mt"}, sL{"astar-alt"}, sO{"astar-octile"}, sF{"astar-fixed"};
+  astar::StaticPlanner<astar::Connect8, astar::Octile, astar::FloatCost> octilePlanner;
+  astar::StaticPlanner<astar::Connect8, astar::Octile, astar::FixedCost<>> fixedPlanner;
+  long long expandedOctile = 0;
+  astar::Planner altPlanner;
+  alt::Landmarks landmarks;
+  double altBuildMs = 0.0;
+  long long expandedPlain = 0, expandedAlt = 0;
+  lattice::Planner latticePlanner(3.f);
+  std::vector<Vec2f> curve;
+  double latticeMs = 0.0, latticeRatio = 0.0;
+  long long latticeQueries = 0, latticeFailed = 0, expandedLattice = 0;
+  flow::FlowField flowField;
+  double sharedAStarMs = 0.0, flowBuildMs = 0.0, flowExtractMs = 0.0, flowMaxRatio = 1.0;
+  long long sharedQueries = 0, flowMismatch = 0;
+  struct RouteMs { float len; double astar, bidir, bidirMt; };
+  std::vector<RouteMs> routes;
+  double openLazy = 0.0, openHeap4 = 0.0, openBucket = 0.0;
+  double thetaVerts = 0.0, astarVerts = 0.0;
+  double hpaBuildMs = 0.0, hpaEditMs = 0.0;
+  long long hpaEdits = 0, hpaRebuilt = 0;
+  std::vector<Vec2i> ref, path;
+  std::mt19937 rng(seed);
+
+  std::unique_ptr<batch::BatchPlanner<>> serialPool, parallelPool;
+  if (threads > 0) {
+    serialPool = std::make_unique<batch::BatchPlanner<>>(1);
+    parallelPool = std::make_unique<batch::BatchPlanner<>>(threads);
+  }
+  std::vector<batch::Query> batchQueries;
+  std::vector<batch::Result> batchResults;
+  double serialWallMs = 0.0, parallelWallMs = 0.0;
+  size_t batchTotal = 0, batchStolen = 0, batchMismatch = 0;
+
+  for (int m = 0; m < maps; ++m) {
+    GridMap map;
+    map.makeRandom(W, H, rects, rmin, rmax, seed + unsigned(m));
+    jpsPlanner.sync(map);
+    auto tb = Clock::now();
+    hpaPlanner.build(map);
+    hpaBuildMs += msSince(tb);
+    tb = Clock::now();
+    landmarks.build(map, landmarkCount);
+    altBuildMs += msSince(tb);
+    const alt::View<GridMap> altView(map, landmarks);
+
+    std::uniform_int_distribution<int> xd(0, W - 1), yd(0, H - 1);
+    auto freeCell = [&]() {
+      for (;;) { Vec2i c{xd(rng), yd(rng)}; if (map.isFree(c.x, c.y)) return c; }
+    };
+    batchQueries.clear();
+    for (int q = 0; q < queries; ++q) {
+      Vec2i s = freeCell(), g = freeCell();
+      batchQueries.push_back({s, g});
+      auto t0 = Clock::now();
+      astarPlanner.plan(map, s, g, ref);
+      double ta = msSince(t0);
+      if (ref.empty()) continue; // unreachable pairs say nothing about quality
+      float refLen = gridLength(ref);
+      sA.add(ta, ref, refLen);
+      openLazy += double(astarPlanner.lastStats().maxOpen);
+      t0 = Clock::now();
+      heapPlanner.plan(map, s, g, path);
+      s4.add(msSince(t0), path, refLen);
+      openHeap4 += double(heapPlanner.lastStats().maxOpen);
+      t0 = Clock::now();
+      bucketPlanner.plan(map, s, g, path);
+      sB.add(msSince(t0), path, refLen);
+      openBucket += double(bucketPlanner.lastStats().maxOpen);
+      t0 = Clock::now();
+      jpsPlanner.plan(map, s, g, path);
+      sJ.add(msSince(t0), path, refLen);
+      t0 = Clock::now();
+      hpaPlanner.plan(map, s, g, path);
+      sH.add(msSince(t0), path, refLen);
+      t0 = Clock::now();
+      thetaPlanner.plan(map, s, g, path);
+      sT.add(msSince(t0), path, refLen);
+      astarVerts += double(ref.size());
+      thetaVerts += double(path.size());
+      t0 = Clock::now();
+      bidirPlanner.plan(map, s, g, path);
+      const double td = msSince(t0);
+      sD.add(td, path, refLen);
+      t0 = Clock::now();
+      bidirMtPlanner.plan(map, s, g, path);
+      const double tm = msSince(t0);
+      sM.add(tm, path, refLen);
+      routes.push_back({refLen, ta, td, tm});
+      t0 = Clock::now();
+      altPlanner.plan(altView, s, g, path);
+      sL.add(msSince(t0), path, refLen);
+      expandedPlain += astarPlanner.lastStats().expanded;
+      expandedAlt += altPlanner.lastStats().expanded;
+      t0 = Clock::now();
+      octilePlanner.plan(map, s, g, path);
+      sO.add(msSince(t0), path, refLen);
+      expandedOctile += octilePlanner.lastStats().expanded;
+      t0 = Clock::now();
+      fixedPlanner.plan(map, s, g, path);
+      sF.add(msSince(t0), path, refLen);
+      t0 = Clock::now();
+      const bool curved = latticePlanner.plan(map, s, 0.f, g, curve);
+      latticeMs += msSince(t0);
+      ++latticeQueries;
+      expandedLattice += latticePlanner.lastExpanded();
+      if (!curved) ++latticeFailed;
+      else latticeRatio += latticePlanner.lastLength() / std::max(1e-6f, refLen);
+    }
+
+    if (threads > 0) {
+      serialWallMs += serialPool->run(map, batchQueries, batchResults).wallMs;
+      std::vector<size_t> serialLen;
+      for (auto& r : batchResults) serialLen.push_back(r.path.size());
+      batch::Stats st = parallelPool->run(map, batchQueries, batchResults);
+      parallelWallMs += st.wallMs;
+      batchStolen += st.stolen;
+      batchTotal += batchQueries.size();
+      for (size_t i = 0; i < batchResults.size(); ++i)
+        if (batchResults[i].path.size() != serialLen[i]) ++batchMismatch;
+    }
+
+    // Shared goal: A* per start vs one field build plus cheap extractions
+    {
+      const Vec2i goal = freeCell();
+      auto t0 = Clock::now();
+      flowField.build(map, goal);
+      flowBuildMs += msSince(t0);
+      for (int q = 0; q < queries; ++q) {
+        const Vec2i s = freeCell();
+        t0 = Clock::now();
+        astarPlanner.plan(map, s, goal, ref);
+        sharedAStarMs += msSince(t0);
+        t0 = Clock::now();
+        flowField.plan(map, s, goal, path);
+        flowExtractMs += msSince(t0);
+        ++sharedQueries;
+        if (ref.empty() != path.empty()) { ++flowMismatch; continue; }
+        if (!ref.empty()) flowMaxRatio = std::max(flowMaxRatio, double(gridLength(path) / std::max(1e-6f, gridLength(ref))));
+      }
+    }
+
+    // Incremental maintenance: single-cell edits rebuild only nearby clusters
+    for (int e = 0; e < 20; ++e) {
+      int x = xd(rng), y = yd(rng);
+      map.toggle(x, y);
+      hpaPlanner.cellChanged(map, x, y);
+      auto t0 = Clock::now();
+      hpaPlanner.plan(map, freeCell(), freeCell(), path);
+      hpaEditMs += msSince(t0);
+      hpaRebuilt += hpaPlanner.lastRebuilt();
+      ++hpaEdits;
+    }
+  }
+
+  std::cout << "map " << W << "x" << H << " rects=" << rects << " size=[" << rmin << "," << rmax
+            << "] maps=" << maps << " queries/map=" << queries << "\n";
+  std::cout << std::fixed << std::setprecision(4);
+  std::cout << "engine        mean_ms   mean_ratio  max_ratio  failed\n";
+  for (const EngineStats* st : {&sA, &s4, &sB, &sJ, &sH, &sT, &sD, &sM, &sL, &sO, &sF}) {
+    double n = double(std::max(1LL, st->n));
+    double ok = double(std::max(1LL, st->n - st->failed));
+    std::cout << std::left << std::setw(12) << st->name << std::right
+              << std::setw(10) << st->ms / n
+              << std::setw(12) << st->ratioSum / ok
+              << std::setw(11) << st->ratioMax
+              << std::setw(8) << st->failed << "\n";
+  }
+  std::cout << "hpa cluster=" << cluster << " nodes=" << hpaPlanner.abstractNodes()
+            << " build_ms=" << hpaBuildMs / maps
+            << " edit+plan_ms=" << hpaEditMs / double(std::max(1LL, hpaEdits))
+            << " clusters_rebuilt/edit=" << double(hpaRebuilt) / double(std::max(1LL, hpaEdits)) << "\n";
+  const double nA = double(std::max(1LL, sA.n));
+  std::cout << std::setprecision(0) << "astar peak open entries: lazy=" << openLazy / nA
+            << " heap4=" << openHeap4 / nA << " bucket=" << openBucket / nA << std::setprecision(4) << "\n";
+  std::cout << "path vertices: astar=" << astarVerts / double(std::max(1LL, sA.n))
+            << " lazytheta=" << thetaVerts / double(std::max(1LL, sT.n)) << "\n";
+  std::cout << "alt landmarks=" << landmarks.count() << " build_ms=" << altBuildMs / maps
+            << " expanded/query: astar=" << double(expandedPlain) / nA << " alt=" << double(expandedAlt) / nA
+            << " octile=" << double(expandedOctile) / nA << "\n";
+  std::cout << "lattice r=" << std::setprecision(1) << latticePlanner.primitives().turnRadius() << std::setprecision(4)
+            << " primitives=" << latticePlanner.primitives().size()
+            << " mean_ms=" << latticeMs / double(std::max(1LL, latticeQueries))
+            << " length_ratio=" << latticeRatio / double(std::max(1LL, latticeQueries - latticeFailed))
+            << " expanded=" << double(expandedLattice) / double(std::max(1LL, latticeQueries))
+            << " failed=" << latticeFailed << "\n";
+  std::cout << "shared goal (" << queries << " starts/map): astar_ms=" << sharedAStarMs / maps
+            << " flow_build_ms=" << flowBuildMs / maps << " flow_extract_ms=" << flowExtractMs / maps
+            << " max_ratio=" << flowMaxRatio << " mismatched=" << flowMismatch << "\n";
+  if (!routes.empty()) {
+    std::sort(routes.begin(), routes.end(), [](const RouteMs& a, const RouteMs& b) { return a.len > b.len; });
+    const size_t nLong = std::max<size_t>(1, routes.size() / 10);
+    double la = 0.0, ld = 0.0, lm = 0.0;
+    for (size_t i = 0; i < nLong; ++i) { la += routes[i].astar; ld += routes[i].bidir; lm += routes[i].bidirMt; }
+    std::cout << "longest " << nLong << " routes mean_ms: astar=" << la / double(nLong) << " bidir=" << ld / double(nLong)
+              << " bidir-mt=" << lm / double(nLong) << "\n";
+  }
+  if (threads > 0) {
+    auto qps = [&](double ms) { return ms > 0.0 ? 1000.0 * double(batchTotal) / ms : 0.0; };
+    std::cout << std::setprecision(1)
+              << "batch astar queries=" << batchTotal
+              << " qps@1=" << qps(serialWallMs)
+              << " qps@" << parallelPool->threads() << "=" << qps(parallelWallMs)
+              << std::setprecision(2)
+              << " speedup=" << (parallelWallMs > 0.0 ? serialWallMs / parallelWallMs : 0.0)
+              << " stolen=" << batchStolen << " mismatched=" << batchMismatch << "\n";
+  }
+  return 0;
+}
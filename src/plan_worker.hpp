@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "geometry.hpp"
+#include "map.hpp"
+#include "profiler.hpp"
+
+// Background planning thread with latest-request-wins semantics. submit()
+// never blocks: it replaces any queued request and raises the cancel flag so
+// an in-flight search stops early (planners poll it via setCancelFlag). The
+// caller keeps using its current path and swaps in the new one when poll()
+// hands over a finished result; results of superseded requests are dropped.
+namespace worker {
+
+struct Request {
+  std::shared_ptr<const GridMap> map; // immutable snapshot taken at submit time
+  Vec2i start, goal;
+  int engine = 0;    // caller-defined planner selector
+  int smoothing = 0; // caller-defined post-processing parameter
+  unsigned long long id = 0;
+};
+
+struct Result {
+  unsigned long long id = 0;
+  int engine = 0;            // copied from the request
+  int smoothing = 0;         // copied from the request
+  std::vector<Vec2i> path;   // empty if no path (or cancelled)
+  std::vector<Vec2f> smooth; // optional post-processed path
+  double ms = 0.0;           // wall time of the solve callback
+};
+
+class PlanWorker {
+public:
+  // Runs on the worker thread. It may read the request's map snapshot freely
+  // and should poll cancelFlag() (directly or through the planners).
+  using Solve = std::function<void(const Request&, Result&)>;
+
+  explicit PlanWorker(Solve solve) : solve_(std::move(solve)), thread_([this] { run(); }) {}
+
+  ~PlanWorker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+      cancel_.store(true, std::memory_order_relaxed);
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  PlanWorker(const PlanWorker&) = delete;
+  PlanWorker& operator=(const PlanWorker&) = delete;
+
+  const std::atomic<bool>* cancelFlag() const { return &cancel_; }
+
+  // Queue a request, superseding (and cancelling) any older one; returns its id.
+  unsigned long long submit(Request req) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      req.id = ++lastId_;
+      pending_ = std::move(req);
+      hasPending_ = true;
+      cancel_.store(true, std::memory_order_relaxed);
+    }
+    wake_.notify_one();
+    return lastId_;
+  }
+
+  // Take the result of the most recent request if it has finished.
+  bool poll(Result& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!hasReady_) return false;
+    hasReady_ = false;
+    if (ready_.id != lastId_) return false; // a newer request is still running
+    out = std::move(ready_);
+    return true;
+  }
+
+  // True while a request is queued or being solved.
+  bool busy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hasPending_ || running_;
+  }
+
+private:
+  Solve solve_;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::atomic<bool> cancel_{false};
+  bool stop_ = false, hasPending_ = false, hasReady_ = false, running_ = false;
+  unsigned long long lastId_ = 0;
+  Request pending_;
+  Result ready_;
+  std::thread thread_; // last member: started after everything above exists
+
+  void run() {
+    PP_PROF_THREAD("planner");
+    for (;;) {
+      Request req;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stop_ || hasPending_; });
+        if (stop_) return;
+        req = std::move(pending_);
+        hasPending_ = false;
+        running_ = true;
+        cancel_.store(false, std::memory_order_relaxed);
+      }
+      Result res;
+      res.id = req.id;
+      res.engine = req.engine;
+      res.smoothing = req.smoothing;
+      auto t0 = std::chrono::high_resolution_clock::now();
+      {
+        PP_PROF_SCOPE("worker.solve");
+        solve_(req, res);
+      }
+      res.ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+      if (cancel_.load(std::memory_order_relaxed)) { PP_PROF_COUNT("worker.superseded", 1); continue; } // superseded
+      ready_ = std::move(res);
+      hasReady_ = true;
+    }
+  }
+};
+
+} // namespace worker
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Hot-path instrumentation. PP_PROF_SCOPE("name") times the enclosing block,
+// PP_PROF_COUNT("name", n) adds n to a counter and PP_PROF_THREAD("name")
+// labels the calling thread in traces. Scopes and counters register their site
+// once (function-local static) and then only touch relaxed atomics, plus a
+// per-thread event buffer while a trace is being recorded. Build with
+// PP_PROFILE=1 (CMake: -DENABLE_PROFILING=ON) to enable them; otherwise the
+// macros expand to nothing and the counted expressions are not evaluated.
+//
+// report() prints per-site totals (for a periodic summary) and
+// writeChromeTrace() exports the recorded scopes as Chrome trace-event JSON,
+// which chrome://tracing and ui.perfetto.dev open directly.
+#ifndef PP_PROFILE
+#define PP_PROFILE 0
+#endif
+
+namespace prof {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr bool enabled() { return PP_PROFILE != 0; }
+
+struct Site {
+  const char* name;
+  bool counter;                       // PP_PROF_COUNT site, else a timed scope
+  std::atomic<long long> calls{0};    // scopes: entries; counters: updates
+  std::atomic<long long> total{0};    // scopes: ns; counters: sum
+  std::atomic<long long> maxNs{0};
+
+  Site(const char* n, bool c) : name(n), counter(c) {}
+};
+
+struct Event {
+  const Site* site;
+  long long ts;    // ns since the registry epoch
+  long long value; // scope duration in ns, or the counter's running total
+};
+
+struct ThreadLog {
+  std::mutex mutex; // uncontended except while a trace is exported
+  int tid = 0;
+  std::string name;
+  std::vector<Event> events;
+  long long dropped = 0;
+};
+
+class Registry {
+public:
+  static Registry& get() { static Registry r; return r; }
+
+  // Find or create the site called `name` (a string literal).
+  Site* site(const char* name, bool counter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Site& s : sites_)
+      if (std::strcmp(s.name, name) == 0) return &s;
+    sites_.emplace_back(name, counter);
+    return &sites_.back();
+  }
+
+  long long now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch_).count();
+  }
+
+  bool tracing() const { return tracing_.load(std::memory_order_acquire); }
+
+  // Calling thread's event buffer (created on first use, never freed, so
+  // events of finished threads can still be exported).
+  ThreadLog& thread() {
+    thread_local ThreadLog* log = nullptr;
+    if (!log) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      logs_.push_back(std::make_unique<ThreadLog>());
+      log = logs_.back().get();
+      log->tid = int(logs_.size());
+    }
+    return *log;
+  }
+
+  void setThreadName(const std::string& name) {
+    ThreadLog& t = thread();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    t.name = name;
+  }
+
+  void timed(Site* s, long long t0, long long ns) {
+    s->calls.fetch_add(1, std::memory_order_relaxed);
+    s->total.fetch_add(ns, std::memory_order_relaxed);
+    long long m = s->maxNs.load(std::memory_order_relaxed);
+    while (ns > m && !s->maxNs.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {}
+    if (tracing()) record({s, t0, ns});
+  }
+
+  void count(Site* s, long long n) {
+    s->calls.fetch_add(1, std::memory_order_relaxed);
+    long long v = s->total.fetch_add(n, std::memory_order_relaxed) + n;
+    if (tracing()) record({s, now(), v});
+  }
+
+  // Start recording events, keeping at most maxEvents per thread.
+  void startTrace(size_t maxEvents = size_t(1) << 20) {
+    maxEvents_ = maxEvents;
+    tracing_.store(true, std::memory_order_release);
+  }
+
+  // Stop recording and write the events as Chrome trace JSON.
+  bool writeChromeTrace(const std::string& path) {
+    tracing_.store(false, std::memory_order_relaxed);
+    std::ofstream out(path);
+    if (!out) {
+      std::cerr << "Failed to open trace file '" << path << "'\n";
+      return false;
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << std::fixed << std::setprecision(3);
+    bool first = true;
+    long long dropped = 0;
+    auto sep = [&]() { out << (first ? "" : ",\n"); first = false; };
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& t : logs_) {
+      std::lock_guard<std::mutex> tl(t->mutex);
+      dropped += t->dropped;
+      if (!t->name.empty()) {
+        sep();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->tid
+            << ",\"args\":{\"name\":\"" << t->name << "\"}}";
+      }
+      for (const Event& e : t->events) {
+        sep();
+        if (e.site->counter) {
+          out << "{\"name\":\"" << e.site->name << "\",\"ph\":\"C\",\"pid\":1,\"tid\":" << t->tid
+              << ",\"ts\":" << double(e.ts) / 1e3 << ",\"args\":{\"value\":" << e.value << "}}";
+        } else {
+          out << "{\"name\":\"" << e.site->name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->tid
+              << ",\"ts\":" << double(e.ts) / 1e3 << ",\"dur\":" << double(e.value) / 1e3 << "}";
+        }
+      }
+    }
+    out << "\n]}\n";
+    if (dropped) std::cerr << "Trace: dropped " << dropped << " events (per-thread buffer full)\n";
+    return bool(out);
+  }
+
+  // Per-site summary since the last reset: scopes with calls, total, mean
+  // and max time; counters with their sum and rate over `seconds`.
+  void report(std::ostream& os, double seconds, bool reset = true) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ios::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(3) << "[prof] last " << seconds << " s\n";
+    for (Site& s : sites_) {
+      long long calls = reset ? s.calls.exchange(0) : s.calls.load();
+      long long total = reset ? s.total.exchange(0) : s.total.load();
+      long long mx = reset ? s.maxNs.exchange(0) : s.maxNs.load();
+      if (calls == 0) continue;
+      os << "  " << std::left << std::setw(22) << s.name << std::right;
+      if (s.counter) {
+        os << " total=" << total << " per_s=" << (seconds > 0.0 ? double(total) / seconds : 0.0) << "\n";
+      } else {
+        os << " calls=" << calls << " total_ms=" << double(total) / 1e6
+           << " mean_us=" << double(total) / 1e3 / double(calls) << " max_us=" << double(mx) / 1e3 << "\n";
+      }
+    }
+    os.flags(flags);
+  }
+
+private:
+  Clock::time_point epoch_ = Clock::now();
+  std::mutex mutex_;
+  std::deque<Site> sites_; // deque: stable addresses for the cached Site*
+  std::vector<std::unique_ptr<ThreadLog>> logs_;
+  std::atomic<bool> tracing_{false};
+  size_t maxEvents_ = 0;
+
+  void record(const Event& e) {
+    ThreadLog& t = thread();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    if (t.events.size() >= maxEvents_) { ++t.dropped; return; }
+    t.events.push_back(e);
+  }
+};
+
+class Scope {
+public:
+  explicit Scope(Site* s) : site_(s), t0_(Registry::get().now()) {}
+  ~Scope() { Registry& r = Registry::get(); r.timed(site_, t0_, r.now() - t0_); }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  Site* site_;
+  long long t0_;
+};
+
+} // namespace prof
+
+#define PP_PROF_CAT2(a, b) a##b
+#define PP_PROF_CAT(a, b) PP_PROF_CAT2(a, b)
+
+#if PP_PROFILE
+#define PP_PROF_SCOPE(name) \
+  static ::prof::Site* const PP_PROF_CAT(ppProfSite_, __LINE__) = ::prof::Registry::get().site(name, false); \
+  ::prof::Scope PP_PROF_CAT(ppProfScope_, __LINE__)(PP_PROF_CAT(ppProfSite_, __LINE__))
+#define PP_PROF_COUNT(name, n) \
+  do { \
+    static ::prof::Site* const ppProfSite_ = ::prof::Registry::get().site(name, true); \
+    ::prof::Registry::get().count(ppProfSite_, (long long)(n)); \
+  } while (0)
+#define PP_PROF_THREAD(name) ::prof::Registry::get().setThreadName(name)
+#else
+#define PP_PROF_SCOPE(name) static_assert(true, "")
+#define PP_PROF_COUNT(name, n) ((void)sizeof(n))
+#define PP_PROF_THREAD(name) ((void)0)
+#endif
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "a_star.hpp"
+#include "bitgrid.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+#include "open_list.hpp"
+#include "profiler.hpp"
+
+// A* with the neighbourhood, heuristic and cost representation fixed at
+// compile time. astar::BasicPlanner always searches 8 directions, evaluates
+// a std::sqrt Euclidean heuristic per push and keeps float g values;
+// StaticPlanner<Conn, Heur, Cost> instead picks:
+//   Conn  Connect8 | Connect4        which freeMask directions are moves
+//   Heur  Octile | Euclidean | Manhattan | Zero (Dijkstra)
+//   Cost  FloatCost | FixedCost<S>   g as float, or as int32 in units of 1/S
+// Step costs and the heuristic's constants are constexpr tables, and the
+// neighbour loop visits only the set bits of the masked freeMask, so each
+// combination compiles to its own branch-light inner loop. With FixedCost
+// the search does no floating-point arithmetic at all (unless the grid has a
+// cellCost hook) and the same inputs give bit-identical paths and costs on
+// every machine.
+//
+// FixedCost rounds the diagonal step down (1448 for S = 1024, vs 1448.15),
+// so paths are optimal in that metric and within 1e-4 of the float optimum.
+// Octile is the exact obstacle-free distance of the chosen costs, so it is
+// the tightest admissible heuristic here; Euclidean is scaled so it stays
+// below octile with either cost type. Manhattan is only admissible with
+// Connect4 (with Connect8 it overestimates diagonals and returns near-optimal
+// paths, like weighted A*). The grid's optional cellCost hook is honoured as
+// in BasicPlanner; the heuristic hook is not (use BasicPlanner with
+// alt::View for landmarks).
+namespace astar {
+
+// Neighbourhoods, as masks over the freeMask direction bits.
+struct Connect8 { static constexpr unsigned kMask = 0xffu; };
+struct Connect4 { static constexpr unsigned kMask = 0x55u; }; // directions 0, 2, 4, 6
+
+// Cost representations. kStraight / kDiagonal are the step costs.
+struct FloatCost {
+  using Value = float;
+  static constexpr Value kStraight = 1.f;
+  static constexpr Value kDiagonal = 1.41421356f;
+  static constexpr Value kInf = std::numeric_limits<float>::infinity();
+  static Value scale(Value step, float cellCost) { return step * (1.f + cellCost); }
+  static float toFloat(Value v) { return v; }
+};
+
+template <int32_t S = 1024>
+struct FixedCost {
+  static_assert(S > 0 && S <= (1 << 16), "scale must leave room for long paths in 31 bits");
+  using Value = int32_t;
+  static constexpr Value kStraight = S;
+  static constexpr Value kDiagonal = Value(S * 1.4142135623730951); // rounded down
+  static constexpr Value kInf = std::numeric_limits<int32_t>::max();
+  // Rounded to nearest; cellCost >= 0 keeps the step at least its base cost.
+  static Value scale(Value step, float cellCost) { return Value(std::lround(double(step) * (1.0 + double(cellCost)))); }
+  static float toFloat(Value v) { return float(v) / float(S); }
+};
+
+// Heuristics over |dx|, |dy| in the units of Cost.
+struct Octile {
+  template <class Cost>
+  static constexpr typename Cost::Value eval(int dx, int dy) {
+    const int lo = std::min(dx, dy), hi = std::max(dx, dy);
+    return Cost::kStraight * typename Cost::Value(hi - lo) + Cost::kDiagonal * typename Cost::Value(lo);
+  }
+};
+
+struct Manhattan {
+  template <class Cost>
+  static constexpr typename Cost::Value eval(int dx, int dy) { return Cost::kStraight * typename Cost::Value(dx + dy); }
+};
+
+struct Euclidean {
+  // Scaled by kDiagonal / sqrt(2) <= kStraight so it never exceeds octile.
+  template <class Cost>
+  static typename Cost::Value eval(int dx, int dy) {
+    const double d = std::sqrt(double(dx) * dx + double(dy) * dy) * (double(Cost::kDiagonal) / 1.4142135623730951);
+    return typename Cost::Value(d); // integer costs round down
+  }
+};
+
+struct Zero {
+  template <class Cost>
+  static constexpr typename Cost::Value eval(int, int) { return typename Cost::Value(0); }
+};
+
+template <class Conn = Connect8, class Heur = Octile, class Cost = FloatCost>
+class StaticPlanner {
+public:
+  using Value = typename Cost::Value;
+
+  template <class Grid>
+  std::vector<Vec2i> plan(const Grid& map, Vec2i start, Vec2i goal) {
+    std::vector<Vec2i> path;
+    plan(map, start, goal, path);
+    return path;
+  }
+
+  // While *flag is true, plan() abandons its search and returns false.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; }
+
+  const SearchStats& lastStats() const { return stats_; }
+  // Cost of the last path found, in Cost units (exact for FixedCost).
+  Value lastCost() const { return cost_; }
+
+  // Writes the path into `out` (cleared first); returns false if none exists.
+  template <class Grid>
+  bool plan(const Grid& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    PP_PROF_SCOPE("astar.static_plan");
+    bool found = search(map, start, goal, out);
+    PP_PROF_COUNT("astar.expanded", stats_.expanded);
+    PP_PROF_COUNT("astar.pushes", stats_.pushes);
+    return found;
+  }
+
+private:
+  static constexpr int kDx[8] = {1,1,0,-1,-1,-1,0,1};
+  static constexpr int kDy[8] = {0,1,1,1,0,-1,-1,-1};
+  static constexpr Value kStep[8] = {Cost::kStraight, Cost::kDiagonal, Cost::kStraight, Cost::kDiagonal,
+                                     Cost::kStraight, Cost::kDiagonal, Cost::kStraight, Cost::kDiagonal};
+
+  CancelFlag cancel_;
+  SearchStats stats_;
+  Value cost_ = 0;
+  int w_ = 0, h_ = 0;
+  uint32_t gen_ = 0;
+  std::vector<uint32_t> seen_;   // generation in which g_/came_ were last written
+  std::vector<uint32_t> closed_; // generation in which the cell was expanded
+  std::vector<Value> g_;
+  std::vector<int> came_;
+  BasicIndexedHeap4<Value> open_;
+
+  static Value h(int x, int y, Vec2i goal) {
+    return Heur::template eval<Cost>(std::abs(x - goal.x), std::abs(y - goal.y));
+  }
+
+  template <class Grid>
+  bool search(const Grid& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    out.clear();
+    stats_ = {};
+    cost_ = 0;
+    if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return false;
+    if (!map.isFree(start.x, start.y) || !map.isFree(goal.x, goal.y)) return false;
+
+    const int w = map.w;
+    prepare(map.w, map.h);
+    const int offset[8] = {1, w + 1, w, w - 1, -1, -w - 1, -w, -w + 1}; // kDy[k] * w + kDx[k]
+
+    const int s = idx(start.x, start.y, w), t = idx(goal.x, goal.y, w);
+    touch(s);
+    g_[s] = 0;
+    push(s, h(start.x, start.y, goal));
+
+    bool found = false;
+    while (!open_.empty()) {
+      if (cancel_.poll()) return false;
+      const int id = open_.pop();
+      closed_[id] = gen_; // decrease-key: no stale entries
+      ++stats_.expanded;
+      if (id == t) { found = true; break; }
+
+      const int cx = id % w, cy = id / w;
+      const Value gc = g_[id];
+      for (unsigned m = unsigned(map.freeMask(cx, cy)) & Conn::kMask; m; m &= m - 1) {
+        const int k = bits::ctz64(m);
+        const int nid = id + offset[k];
+        if (closed_[nid] == gen_) continue; // consistent heuristic: closed cells are final
+        touch(nid);
+        Value step = kStep[k];
+        if constexpr (HasCellCost<Grid>::value) step = Cost::scale(step, map.cellCost(cx + kDx[k], cy + kDy[k]));
+        const Value tentative = gc + step;
+        if (tentative < g_[nid]) {
+          g_[nid] = tentative;
+          came_[nid] = id;
+          push(nid, tentative + h(cx + kDx[k], cy + kDy[k], goal));
+        }
+      }
+    }
+
+    if (!found) return false;
+    cost_ = g_[t];
+    for (int cur = t; cur != -1; cur = came_[cur]) out.push_back({cur % w, cur / w});
+    std::reverse(out.begin(), out.end());
+    return true;
+  }
+
+  void prepare(int w, int h) {
+    if (w != w_ || h != h_) {
+      w_ = w; h_ = h;
+      seen_.assign(size_t(w) * h, 0);
+      closed_.assign(size_t(w) * h, 0);
+      g_.resize(size_t(w) * h);
+      came_.resize(size_t(w) * h);
+      open_.reset(size_t(w) * h);
+      gen_ = 0;
+    }
+    if (++gen_ == 0) { // stamp wrap-around: clear once every 2^32 queries
+      std::fill(seen_.begin(), seen_.end(), 0u);
+      std::fill(closed_.begin(), closed_.end(), 0u);
+      gen_ = 1;
+    }
+    open_.clear();
+  }
+
+  void touch(int id) {
+    if (seen_[id] == gen_) return;
+    seen_[id] = gen_;
+    g_[id] = Cost::kInf;
+    came_[id] = -1;
+  }
+
+  void push(int id, Value f) {
+    ++stats_.pushes;
+    open_.push(id, f);
+    stats_.maxOpen = std::max(stats_.maxOpen, open_.size());
+  }
+};
+
+// Exact grid distance to a goal under Conn's moves (steps cost kStraight or
+// kDiagonal), computed on demand: a backward A* from the goal towards the
+// caller's start, guided by Heur, that is resumed whenever a cell it has not
+// settled yet is queried ("reverse resumable A*"). Unlike a flow::FlowField
+// it only settles the cells between the two endpoints. Searches over other
+// state spaces (lattice.hpp, coop.hpp) use it as their heuristic; Heur must
+// be admissible for Conn.
+template <class Conn = Connect8, class Heur = Octile>
+class ReverseDistance {
+public:
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; }
+  long long settled() const { return settled_; }
+
+  void start(const GridMap& map, Vec2i goal, Vec2i towards) {
+    map_ = &map;
+    towards_ = towards;
+    settled_ = 0;
+    const size_t n = size_t(map.w) * size_t(map.h);
+    if (map.w != w_ || map.h != h_) {
+      w_ = map.w; h_ = map.h;
+      seen_.assign(n, 0);
+      dist_.resize(n);
+      open_.reset(n);
+      gen_ = 0;
+    }
+    if (++gen_ >= (1u << 31)) { // stamp wrap-around
+      std::fill(seen_.begin(), seen_.end(), 0u);
+      gen_ = 1;
+    }
+    open_.clear();
+    const int t = idx(goal.x, goal.y, w_);
+    seen_[size_t(t)] = gen_ << 1;
+    dist_[size_t(t)] = 0.f;
+    open_.push(t, h(goal.x, goal.y));
+  }
+
+  // Path cost from free cell (x, y) to the goal; infinity if unreachable or
+  // the search was cancelled.
+  float distance(int x, int y) {
+    const size_t id = size_t(idx(x, y, w_));
+    const uint32_t closed = (gen_ << 1) | 1u;
+    while (seen_[id] != closed) {
+      if (open_.empty() || cancel_.poll()) return kInf;
+      expand(open_.pop());
+    }
+    return dist_[id];
+  }
+
+private:
+  static constexpr int kDx[8] = {1,1,0,-1,-1,-1,0,1};
+  static constexpr int kDy[8] = {0,1,1,1,0,-1,-1,-1};
+  static constexpr float kCost[8] = {FloatCost::kStraight, FloatCost::kDiagonal, FloatCost::kStraight, FloatCost::kDiagonal,
+                                     FloatCost::kStraight, FloatCost::kDiagonal, FloatCost::kStraight, FloatCost::kDiagonal};
+  static constexpr float kInf = std::numeric_limits<float>::infinity();
+
+  const GridMap* map_ = nullptr;
+  Vec2i towards_{0, 0};
+  CancelFlag cancel_;
+  IndexedHeap4 open_;
+  long long settled_ = 0;
+  int w_ = -1, h_ = -1;
+  uint32_t gen_ = 0;
+  std::vector<uint32_t> seen_; // (generation << 1) | closed
+  std::vector<float> dist_;
+
+  float h(int x, int y) const {
+    return Heur::template eval<FloatCost>(std::abs(x - towards_.x), std::abs(y - towards_.y));
+  }
+
+  // Moves only need their destination free, so an edge's reverse is an edge
+  // of the same cost, as in flow::FlowField::build().
+  void expand(int id) {
+    seen_[size_t(id)] |= 1u;
+    ++settled_;
+    const int cx = id % w_, cy = id / w_;
+    const float d = dist_[size_t(id)];
+    const uint32_t open = gen_ << 1;
+    for (unsigned m = unsigned(map_->freeMask(cx, cy)) & Conn::kMask; m; m &= m - 1) {
+      const int k = bits::ctz64(m);
+      const int nx = cx + kDx[k], ny = cy + kDy[k];
+      const size_t nid = size_t(idx(nx, ny, w_));
+      const float nd = d + kCost[k];
+      if (seen_[nid] == open + 1u) continue;
+      if (seen_[nid] == open && !(nd < dist_[nid])) continue;
+      seen_[nid] = open;
+      dist_[nid] = nd;
+      open_.push(int(nid), nd + h(nx, ny));
+    }
+  }
+};
+
+// Tag naming one StaticPlanner instantiation, for selectStatic().
+template <class Conn, class Heur, class Cost>
+struct StaticPolicies { using Planner = StaticPlanner<Conn, Heur, Cost>; };
+
+// Map run-time choices (neighbours 4 or 8; heuristic octile, euclid,
+// manhattan or zero; cost float or fixed) to a StaticPolicies tag and call
+// fn(tag). Returns false for an unknown choice. Every combination is
+// instantiated, so callers should keep the planner they create.
+template <class Fn>
+bool selectStatic(int neighbors, const std::string& heuristic, const std::string& cost, Fn&& fn) {
+  auto withCost = [&](auto conn, auto heur) {
+    using C = decltype(conn);
+    using H = decltype(heur);
+    if (cost == "float") fn(StaticPolicies<C, H, FloatCost>{});
+    else if (cost == "fixed") fn(StaticPolicies<C, H, FixedCost<>>{});
+    else return false;
+    return true;
+  };
+  auto withHeur = [&](auto conn) {
+    if (heuristic == "octile") return withCost(conn, Octile{});
+    if (heuristic == "euclid") return withCost(conn, Euclidean{});
+    if (heuristic == "manhattan") return withCost(conn, Manhattan{});
+    if (heuristic == "zero") return withCost(conn, Zero{});
+    return false;
+  };
+  if (neighbors == 8) return withHeur(Connect8{});
+  if (neighbors == 4) return withHeur(Connect4{});
+  return false;
+}
+
+} // namespace astar
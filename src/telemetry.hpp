@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "profiler.hpp"
+
+// Asynchronous per-tick telemetry. The simulation thread pushes fixed-size
+// samples into a single-producer/single-consumer ring and never blocks: when
+// the ring is full the sample is dropped and counted. A background thread
+// drains the ring and writes either the classic CSV or a compact columnar
+// binary log (".ptl"), which toCsv() turns back into the same CSV.
+//
+// Binary layout (host byte order, little-endian on all supported targets):
+//   char[4] "PPTL", u32 version, u32 columns,
+//   per column: u8 type (0 = f32, 1 = f64), u8 name length, name bytes;
+//   then blocks until EOF: u32 rows, followed by each column's values
+//   stored contiguously (rows x sizeof(type)).
+namespace telemetry {
+
+struct Sample {
+  double t;
+  float x, y, theta, v, omega, errLat, pathLen, planMs;
+};
+
+enum class Format { Csv, Binary };
+
+inline const char* csvHeader() { return "t,x,y,theta,v,omega,err_lat,path_len,plan_ms"; }
+
+// Lock-free ring for one producer and one consumer thread. Capacity is
+// rounded up to a power of two.
+template <class T>
+class SpscRing {
+public:
+  explicit SpscRing(size_t capacity) {
+    size_t n = 1;
+    while (n < capacity) n <<= 1;
+    buf_.resize(n);
+    mask_ = n - 1;
+  }
+
+  // Producer side. Returns false (without waiting) if the ring is full.
+  bool push(const T& v) {
+    size_t h = head_.load(std::memory_order_relaxed);
+    if (h - tailCache_ > mask_) {
+      tailCache_ = tail_.load(std::memory_order_acquire);
+      if (h - tailCache_ > mask_) return false;
+    }
+    buf_[h & mask_] = v;
+    head_.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Copies up to `max` items into `out`; returns the count.
+  size_t pop(T* out, size_t max) {
+    size_t t = tail_.load(std::memory_order_relaxed);
+    size_t n = std::min(max, head_.load(std::memory_order_acquire) - t);
+    for (size_t i = 0; i < n; ++i) out[i] = buf_[(t + i) & mask_];
+    tail_.store(t + n, std::memory_order_release);
+    return n;
+  }
+
+private:
+  std::vector<T> buf_;
+  size_t mask_ = 0;
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t tailCache_ = 0; // producer's last view of tail_
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+class Writer {
+public:
+  explicit Writer(size_t capacity = 1 << 16) : ring_(capacity) {}
+  ~Writer() { close(); }
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  bool open(const std::string& path, Format fmt) {
+    close();
+    out_.open(path, std::ios::binary);
+    if (!out_) {
+      std::cerr << "Failed to open telemetry log '" << path << "'\n";
+      return false;
+    }
+    fmt_ = fmt;
+    if (fmt_ == Format::Csv) out_ << csvHeader() << "\n";
+    else writeHeader();
+    dropped_.store(0, std::memory_order_relaxed);
+    stop_.store(false, std::memory_order_relaxed);
+    thread_ = std::thread([this] { run(); });
+    return true;
+  }
+
+  // Called from the simulation thread; never blocks.
+  void push(const Sample& s) {
+    if (!thread_.joinable()) return;
+    if (!ring_.push(s)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      PP_PROF_COUNT("telemetry.dropped", 1);
+    }
+  }
+
+  // Drain pending samples, flush and stop the writer thread.
+  void close() {
+    if (!thread_.joinable()) return;
+    stop_.store(true, std::memory_order_release);
+    thread_.join();
+    out_.close();
+    if (long long d = dropped()) std::cerr << "Telemetry: dropped " << d << " samples (writer fell behind)\n";
+  }
+
+  long long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  static constexpr size_t kBlockRows = 4096; // rows per binary block, at most
+
+private:
+  static constexpr size_t kBatch = 1024;
+  static constexpr uint32_t kVersion = 1;
+
+  SpscRing<Sample> ring_;
+  std::ofstream out_;
+  Format fmt_ = Format::Csv;
+  std::thread thread_;
+  std::atomic<bool> stop_{false};
+  std::atomic<long long> dropped_{0};
+  std::vector<Sample> block_; // rows of the binary block being assembled
+
+  static constexpr float Sample::* kFloatCols[] = {
+    &Sample::x, &Sample::y, &Sample::theta, &Sample::v, &Sample::omega,
+    &Sample::errLat, &Sample::pathLen, &Sample::planMs};
+
+  template <class T> void put(const T& v) { out_.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+  void writeHeader() {
+    static const char* names[] = {"t", "x", "y", "theta", "v", "omega", "err_lat", "path_len", "plan_ms"};
+    out_.write("PPTL", 4);
+    put(kVersion);
+    put(uint32_t(9));
+    for (int c = 0; c < 9; ++c) {
+      put(uint8_t(c == 0 ? 1 : 0));
+      put(uint8_t(std::strlen(names[c])));
+      out_.write(names[c], std::streamsize(std::strlen(names[c])));
+    }
+    block_.reserve(kBlockRows);
+  }
+
+  void flushBlock() {
+    if (block_.empty()) return;
+    put(uint32_t(block_.size()));
+    for (const Sample& s : block_) put(s.t);
+    for (auto col : kFloatCols)
+      for (const Sample& s : block_) put(s.*col);
+    block_.clear();
+  }
+
+  void write(const Sample* s, size_t n) {
+    PP_PROF_SCOPE("telemetry.write");
+    PP_PROF_COUNT("telemetry.samples", n);
+    for (size_t i = 0; i < n; ++i) {
+      if (fmt_ == Format::Csv) {
+        out_ << s[i].t << "," << s[i].x << "," << s[i].y << "," << s[i].theta << ","
+             << s[i].v << "," << s[i].omega << "," << s[i].errLat << ","
+             << s[i].pathLen << "," << s[i].planMs << "\n";
+      } else {
+        block_.push_back(s[i]);
+        if (block_.size() == kBlockRows) flushBlock();
+      }
+    }
+  }
+
+  void run() {
+    PP_PROF_THREAD("telemetry");
+    std::vector<Sample> batch(kBatch);
+    for (;;) {
+      size_t n = ring_.pop(batch.data(), kBatch);
+      if (n) { write(batch.data(), n); continue; }
+      if (stop_.load(std::memory_order_acquire)) {
+        // The producer has stopped; one more pass picks up anything it pushed before
+        while ((n = ring_.pop(batch.data(), kBatch)) > 0) write(batch.data(), n);
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    if (fmt_ == Format::Binary) flushBlock();
+    out_.flush();
+  }
+};
+
+// Convert a binary log written by Writer back to CSV (same header and
+// number formatting as Format::Csv). Returns false on a malformed file.
+inline bool toCsv(std::istream& in, std::ostream& out) {
+  char magic[4];
+  uint32_t version = 0, cols = 0;
+  in.read(magic, 4);
+  in.read(reinterpret_cast<char*>(&version), 4);
+  in.read(reinterpret_cast<char*>(&cols), 4);
+  if (!in || std::memcmp(magic, "PPTL", 4) != 0) { std::cerr << "Not a telemetry log\n"; return false; }
+  if (version != 1) { std::cerr << "Unsupported telemetry version " << version << "\n"; return false; }
+  if (cols == 0 || cols > 255) { std::cerr << "Bad telemetry column count\n"; return false; }
+
+  std::vector<uint8_t> types(cols);
+  for (uint32_t c = 0; c < cols; ++c) {
+    uint8_t len = 0;
+    in.read(reinterpret_cast<char*>(&types[c]), 1);
+    in.read(reinterpret_cast<char*>(&len), 1);
+    std::string name(len, '\0');
+    in.read(&name[0], len);
+    if (!in || types[c] > 1) { std::cerr << "Bad telemetry schema\n"; return false; }
+    out << (c ? "," : "") << name;
+  }
+  out << "\n";
+
+  std::vector<std::vector<double>> data(cols);
+  for (;;) {
+    uint32_t rows = 0;
+    if (!in.read(reinterpret_cast<char*>(&rows), 4)) break; // clean EOF
+    if (rows > Writer::kBlockRows) { std::cerr << "Bad telemetry block size " << rows << "\n"; return false; }
+    for (uint32_t c = 0; c < cols; ++c) {
+      data[c].resize(rows);
+      for (uint32_t r = 0; r < rows; ++r) {
+        if (types[c] == 1) { double v; in.read(reinterpret_cast<char*>(&v), 8); data[c][r] = v; }
+        else { float v; in.read(reinterpret_cast<char*>(&v), 4); data[c][r] = v; }
+      }
+      if (!in) { std::cerr << "Truncated telemetry block\n"; return false; }
+    }
+    for (uint32_t r = 0; r < rows; ++r) {
+      for (uint32_t c = 0; c < cols; ++c) out << (c ? "," : "") << data[c][r];
+      out << "\n";
+    }
+  }
+  return true;
+}
+
+} // namespace telemetry
@@ -0,0 +1,24 @@
+// Convert a binary telemetry log (logs/run_*.ptl) back to the sandbox CSV
+// format (t,x,y,theta,v,omega,err_lat,path_len,plan_ms).
+//
+//   telemetry_csv run.ptl [out.csv]     (stdout if no output path)
+
+#include <fstream>
+#include <iostream>
+
+#include "telemetry.hpp"
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "Usage: telemetry_csv run.ptl [out.csv]\n";
+    return 1;
+  }
+  std::ifstream in(argv[1], std::ios::binary);
+  if (!in) { std::cerr << "Failed to open '" << argv[1] << "'\n"; return 1; }
+  if (argc == 3) {
+    std::ofstream out(argv[2]);
+    if (!out) { std::cerr << "Failed to open '" << argv[2] << "'\n"; return 1; }
+    return telemetry::toCsv(in, out) ? 0 : 1;
+  }
+  return telemetry::toCsv(in, std::cout) ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#include "a_star.hpp"
+#include "geometry.hpp"
+#include "map.hpp"
+
+// Any-angle planning (Theta* and Lazy Theta*) on the 8-connected grid. A
+// node may take its grandparent as parent whenever the straight segment
+// between their cell centres is collision free, so paths come out as a few
+// waypoints joined by straight segments instead of one vertex per cell.
+// Consecutive waypoints of the returned path are always in line of sight.
+namespace theta {
+
+// True if the segment between the centres of cells a and b crosses only free
+// cells. Integer grid traversal: steps one cell in x or y depending on which
+// cell border the segment crosses next; when it passes exactly through a
+// cell corner it steps diagonally, matching the planner's movement model
+// (a diagonal move only needs its destination free).
+template <class Grid>
+bool lineOfSight(const Grid& map, Vec2i a, Vec2i b) {
+  int dx = std::abs(b.x - a.x), dy = std::abs(b.y - a.y);
+  const int sx = b.x > a.x ? 1 : -1, sy = b.y > a.y ? 1 : -1;
+  int x = a.x, y = a.y;
+  int err = dx - dy; // compares crossing distances to the next x and y borders
+  dx *= 2; dy *= 2;
+  for (int n = (dx + dy) / 2; n > 0; --n) {
+    if (err > 0) { x += sx; err -= dy; }
+    else if (err < 0) { y += sy; err += dx; }
+    else { x += sx; y += sy; err += dx - dy; --n; }
+    if (!map.isFree(x, y)) return false;
+  }
+  return true;
+}
+
+inline float distance(int a, int b, int w) {
+  return astar::heuristic(a % w, a / w, b % w, b / w);
+}
+
+class Planner {
+public:
+  // Lazy Theta* (default) defers the line-of-sight check until a node is
+  // expanded, doing roughly one check per expansion instead of one per edge.
+  explicit Planner(bool lazy = true) : lazy_(lazy) {}
+
+  bool lazy() const { return lazy_; }
+  void setLazy(bool lazy) { lazy_ = lazy; }
+
+  // While *flag is true, plan() abandons its search and returns false.
+  void setCancelFlag(const std::atomic<bool>* flag) { cancel_.flag = flag; }
+
+  // Line-of-sight checks made by the last plan() call.
+  long long lastLosChecks() const { return losChecks_; }
+
+  template <class Grid>
+  std::vector<Vec2i> plan(const Grid& map, Vec2i start, Vec2i goal) {
+    std::vector<Vec2i> path;
+    plan(map, start, goal, path);
+    return path;
+  }
+
+  // Writes the waypoints into `out` (cleared first); returns false if no
+  // path exists.
+  template <class Grid>
+  bool plan(const Grid& map, Vec2i start, Vec2i goal, std::vector<Vec2i>& out) {
+    out.clear();
+    losChecks_ = 0;
+    if (!map.inBounds(start.x, start.y) || !map.inBounds(goal.x, goal.y)) return false;
+    if (!map.isFree(start.x, start.y) || !map.isFree(goal.x, goal.y)) return false;
+
+    const int w = map.w;
+    prepare(map.w, map.h);
+    const int s = astar::idx(start.x, start.y, w), t = astar::idx(goal.x, goal.y, w);
+    touch(s);
+    g_[s] = 0.f;
+    parent_[s] = s;
+    push({start.x, start.y, astar::heuristic(start.x, start.y, goal.x, goal.y)});
+
+    const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    const float cost[8] = {1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f), 1, std::sqrt(2.f)};
+    auto pos = [w](int id) { return Vec2i{id % w, id / w}; };
+    auto los = [&](int a, int b) { ++losChecks_; return lineOfSight(map, pos(a), pos(b)); };
+
+    bool found = false;
+    while (!open_.empty()) {
+      if (cancel_.poll()) return false;
+      astar::Node n = pop();
+      int id = astar::idx(n.x, n.y, w);
+      if (closed_[id] == gen_) continue;
+      closed_[id] = gen_;
+
+      // Lazy Theta*: the parent was assumed visible; fix it up if it is not
+      // by picking the best already-expanded neighbour (one always exists)
+      if (lazy_ && parent_[id] != id && !los(parent_[id], id)) {
+        g_[id] = std::numeric_limits<float>::infinity();
+        for (int k = 0; k < 8; ++k) {
+          int px = n.x - dx[k], py = n.y - dy[k];
+          if (!map.inBounds(px, py)) continue;
+          int pid = astar::idx(px, py, w);
+          if (closed_[pid] != gen_ || seen_[pid] != gen_) continue;
+          float c = g_[pid] + cost[k];
+          if (c < g_[id]) { g_[id] = c; parent_[id] = pid; }
+        }
+      }
+      if (id == t) { found = true; break; }
+
+      const unsigned freeDirs = map.freeMask(n.x, n.y);
+      for (int k = 0; k < 8; ++k) {
+        if (!((freeDirs >> k) & 1u)) continue;
+        int nx = n.x + dx[k], ny = n.y + dy[k];
+        int nid = astar::idx(nx, ny, w);
+        if (closed_[nid] == gen_) continue;
+        touch(nid);
+        // Path 2 (through the parent) when visible, else path 1 (through id)
+        int p = parent_[id];
+        int from = id;
+        float tentative = g_[id] + cost[k];
+        if (lazy_ || los(p, nid)) {
+          float viaParent = g_[p] + distance(p, nid, w);
+          if (viaParent <= tentative) { tentative = viaParent; from = p; }
+        }
+        if (tentative < g_[nid]) {
+          g_[nid] = tentative;
+          parent_[nid] = from;
+          push({nx, ny, tentative + astar::heuristic(nx, ny, goal.x, goal.y)});
+        }
+      }
+    }
+    if (!found) return false;
+
+    for (int cur = t;; cur = parent_[cur]) {
+      out.push_back(pos(cur));
+      if (cur == s) break;
+    }
+    std::reverse(out.begin(), out.end());
+    return true;
+  }
+
+private:
+  bool lazy_;
+  astar::CancelFlag cancel_;
+  long long losChecks_ = 0;
+  int w_ = 0, h_ = 0;
+  uint32_t gen_ = 0;
+  std::vector<uint32_t> seen_;
+  std::vector<uint32_t> closed_;
+  std::vector<float> g_;
+  std::vector<int> parent_;
+  std::vector<astar::Node> open_;
+
+  void prepare(int w, int h) {
+    if (w != w_ || h != h_) {
+      w_ = w; h_ = h;
+      seen_.assign(size_t(w) * h, 0);
+      closed_.assign(size_t(w) * h, 0);
+      g_.resize(size_t(w) * h);
+      parent_.resize(size_t(w) * h);
+      gen_ = 0;
+    }
+    if (++gen_ == 0) {
+      std::fill(seen_.begin(), seen_.end(), 0u);
+      std::fill(closed_.begin(), closed_.end(), 0u);
+      gen_ = 1;
+    }
+    open_.clear();
+  }
+
+  void touch(int id) {
+    if (seen_[id] == gen_) return;
+    seen_[id] = gen_;
+    g_[id] = std::numeric_limits<float>::infinity();
+    parent_[id] = -1;
+  }
+
+  void push(astar::Node n) { open_.push_back(n); std::push_heap(open_.begin(), open_.end()); }
+  astar::Node pop() { std::pop_heap(open_.begin(), open_.end()); astar::Node n = open_.back(); open_.pop_back(); return n; }
+};
+
+} // namespace theta
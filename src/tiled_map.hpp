@@ -0,0 +1,387 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "map.hpp"
+#include "profiler.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Tiled occupancy format for maps too large to decode at every start. The
+// map is cut into square tiles (power-of-two side, 256 by default). Tiles
+// that are entirely free or entirely blocked are stored as a flag in the
+// tile index and take no space; the others hold one bit per cell (1 =
+// blocked), page-aligned so that memory-mapping the file pages in exactly
+// the tiles that are read. TiledMap maps a file and answers occupancy
+// lookups from it directly, so opening takes milliseconds regardless of map
+// size and only touched tiles become resident. extract() copies a window
+// into a GridMap for the planners and the sandbox.
+//
+// File layout (little-endian):
+//   char[4] "PPTM", u32 version, i32 w, i32 h, u32 tile, u32 tilesX,
+//   u32 tilesY, u32 reserved, then tilesX * tilesY u64 tile entries
+//   (kFree, kBlocked or the byte offset of the tile's bits), then the tile
+//   data, each tile starting on a kAlign boundary, rows of tile / 8 bytes.
+namespace tiles {
+
+constexpr uint64_t kFree = 0, kBlocked = 1; // tile entries of uniform tiles
+constexpr size_t kAlign = 4096;
+constexpr size_t kHeaderBytes = 32;
+
+// Run fn(begin, end) over [0, n) split into contiguous ranges on up to
+// `threads` threads (<= 0: hardware concurrency).
+template <class Fn>
+void parallelRanges(int n, int threads, Fn fn) {
+  if (threads <= 0) threads = int(std::max(1u, std::thread::hardware_concurrency()));
+  threads = std::max(1, std::min(threads, n));
+  std::vector<std::thread> pool;
+  const int chunk = (n + threads - 1) / threads;
+  for (int t = 1; t < threads; ++t) {
+    const int b = t * chunk, e = std::min(n, b + chunk);
+    if (b < e) pool.emplace_back(fn, b, e);
+  }
+  fn(0, std::min(n, chunk));
+  for (std::thread& th : pool) th.join();
+}
+
+// occ[i] = 1 where the luminance of RGBA pixel i is below one half (dark =
+// obstacle), with loadPNG's weights 0.2126 / 0.7152 / 0.0722 scaled to
+// integers so the loop vectorizes (at -O3, the Release default).
+inline void thresholdRGBA(const uint8_t* __restrict rgba, size_t n, uint8_t* __restrict occ) {
+  for (size_t i = 0; i < n; ++i) {
+    const uint32_t lum = 2126u * rgba[4 * i] + 7152u * rgba[4 * i + 1] + 722u * rgba[4 * i + 2];
+    occ[i] = uint8_t(lum < 1275000u); // 0.5 * 255 * 10000
+  }
+}
+
+// thresholdRGBA over a w x h image, rows split across threads.
+inline void thresholdImage(const uint8_t* rgba, int w, int h, std::vector<uint8_t>& occ, int threads = 0) {
+  PP_PROF_SCOPE("tiles.threshold");
+  occ.resize(size_t(w) * size_t(h));
+  parallelRanges(h, threads, [&](int y0, int y1) {
+    const size_t i0 = size_t(y0) * size_t(w), n = size_t(y1 - y0) * size_t(w);
+    thresholdRGBA(rgba + 4 * i0, n, occ.data() + i0);
+  });
+}
+
+// Write `map` in the tiled format. Tiles are classified and packed in
+// parallel, then written in index order.
+inline bool write(const std::string& path, const GridMap& map, int tile = 256, int threads = 0) {
+  PP_PROF_SCOPE("tiles.write");
+  if (tile < 64 || (tile & (tile - 1)) != 0) {
+    std::cerr << "Tile size must be a power of two >= 64, got " << tile << "\n";
+    return false;
+  }
+  const uint32_t tx = uint32_t((map.w + tile - 1) / tile), ty = uint32_t((map.h + tile - 1) / tile);
+  const size_t tileBytes = size_t(tile) * size_t(tile) / 8;
+  const size_t nTiles = size_t(tx) * size_t(ty);
+  std::vector<uint64_t> entry(nTiles);
+  std::vector<std::vector<uint8_t>> bits(nTiles);
+  parallelRanges(int(nTiles), threads, [&](int b, int e) {
+    for (int t = b; t < e; ++t) {
+      const int x0 = int(uint32_t(t) % tx) * tile, y0 = int(uint32_t(t) / tx) * tile;
+      const int x1 = std::min(map.w, x0 + tile), y1 = std::min(map.h, y0 + tile);
+      size_t blocked = 0;
+      for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x) blocked += map.occ[size_t(y) * size_t(map.w) + size_t(x)] != 0;
+      const size_t cells = size_t(x1 - x0) * size_t(y1 - y0);
+      if (blocked == 0) { entry[size_t(t)] = kFree; continue; }
+      if (blocked == cells) { entry[size_t(t)] = kBlocked; continue; }
+      std::vector<uint8_t>& out = bits[size_t(t)];
+      out.assign(tileBytes, 0);
+      for (int y = y0; y < y1; ++y) {
+        const uint8_t* row = &map.occ[size_t(y) * size_t(map.w)];
+        uint8_t* dst = &out[size_t(y - y0) * size_t(tile / 8)];
+        for (int x = x0; x < x1; ++x)
+          if (row[x]) dst[(x - x0) >> 3] |= uint8_t(1u << ((x - x0) & 7));
+      }
+    }
+  });
+
+  std::ofstream out(path, std::ios::binary);
+  if (!out) { std::cerr << "Failed to open tiled map '" << path << "' for writing\n"; return false; }
+  auto put = [&](auto v) { out.write(reinterpret_cast<const char*>(&v), sizeof v); };
+  out.write("PPTM", 4);
+  put(uint32_t(1));
+  put(int32_t(map.w)); put(int32_t(map.h));
+  put(uint32_t(tile)); put(tx); put(ty); put(uint32_t(0));
+  size_t offset = kHeaderBytes + nTiles * sizeof(uint64_t);
+  for (size_t t = 0; t < nTiles; ++t) {
+    if (bits[t].empty()) continue;
+    offset = (offset + kAlign - 1) / kAlign * kAlign;
+    entry[t] = offset;
+    offset += tileBytes;
+  }
+  out.write(reinterpret_cast<const char*>(entry.data()), std::streamsize(nTiles * sizeof(uint64_t)));
+  size_t pos = kHeaderBytes + nTiles * sizeof(uint64_t);
+  const std::vector<char> pad(kAlign, 0);
+  for (size_t t = 0; t < nTiles; ++t) {
+    if (bits[t].empty()) continue;
+    out.write(pad.data(), std::streamsize(entry[t] - pos));
+    out.write(reinterpret_cast<const char*>(bits[t].data()), std::streamsize(tileBytes));
+    pos = entry[t] + tileBytes;
+  }
+  if (!out) { std::cerr << "Failed to write tiled map '" << path << "'\n"; return false; }
+  return true;
+}
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const std::string& path) {
+    close();
+#if defined(_WIN32)
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) { close(); return false; }
+    size_ = size_t(size.QuadPart);
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) { close(); return false; }
+    data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) { close(); return false; }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+    size_ = size_t(st.st_size);
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (p == MAP_FAILED) { size_ = 0; return false; }
+    data_ = static_cast<const uint8_t*>(p);
+#endif
+    return true;
+  }
+
+  void close() {
+#if defined(_WIN32)
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Resident pages in [offset, offset + len), or -1 if unknown.
+  long long residentPages(size_t offset, size_t len) const {
+#if defined(_WIN32)
+    (void)offset; (void)len;
+    return -1;
+#else
+    const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    const size_t b = offset / page * page, e = std::min(size_, offset + len);
+    if (!data_ || e <= b) return 0;
+#if defined(__APPLE__)
+    std::vector<char> vec((e - b + page - 1) / page);
+#else
+    std::vector<unsigned char> vec((e - b + page - 1) / page);
+#endif
+    if (mincore(const_cast<uint8_t*>(data_ + b), e - b, vec.data()) != 0) return -1;
+    long long n = 0;
+    for (auto v : vec) n += v & 1;
+    return n;
+#endif
+  }
+
+private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#if defined(_WIN32)
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#endif
+};
+
+// Memory-mapped tiled map. Exposes the planners' grid interface (w, h,
+// inBounds, isFree, freeMask) straight from the mapping; lookups are safe
+// from several threads.
+class TiledMap {
+  // Byte of 8 occupancy bits -> the 8 occupancy bytes it encodes
+  struct ExpandTable {
+    uint8_t v[256][8];
+    ExpandTable() {
+      for (int b = 0; b < 256; ++b)
+        for (int i = 0; i < 8; ++i) v[b][i] = uint8_t((b >> i) & 1);
+    }
+    const uint8_t* operator[](uint8_t b) const { return v[b]; }
+  };
+  static inline const ExpandTable kExpand{};
+
+public:
+  int w = 0, h = 0;
+
+  // Map `path` and validate its header and tile index.
+  bool open(const std::string& path) {
+    close();
+    if (!file_.open(path)) { std::cerr << "Failed to map '" << path << "'\n"; return false; }
+    const uint8_t* p = file_.data();
+    uint32_t version = 0, tile = 0, tx = 0, ty = 0;
+    int32_t W = 0, H = 0;
+    if (file_.size() < kHeaderBytes || std::memcmp(p, "PPTM", 4) != 0) {
+      std::cerr << "Not a tiled map: '" << path << "'\n";
+      close();
+      return false;
+    }
+    std::memcpy(&version, p + 4, 4);
+    std::memcpy(&W, p + 8, 4); std::memcpy(&H, p + 12, 4);
+    std::memcpy(&tile, p + 16, 4); std::memcpy(&tx, p + 20, 4); std::memcpy(&ty, p + 24, 4);
+    if (version != 1) { std::cerr << "Unsupported tiled map version " << version << "\n"; close(); return false; }
+    const size_t nTiles = size_t(tx) * size_t(ty);
+    const bool shapeOk = W > 0 && H > 0 && tile >= 64 && (tile & (tile - 1)) == 0 &&
+                         tx == (uint32_t(W) + tile - 1) / tile && ty == (uint32_t(H) + tile - 1) / tile;
+    if (!shapeOk || file_.size() < kHeaderBytes + nTiles * sizeof(uint64_t)) {
+      std::cerr << "Corrupt tiled map header in '" << path << "'\n";
+      close();
+      return false;
+    }
+    index_ = reinterpret_cast<const uint64_t*>(p + kHeaderBytes); // 8-byte aligned: header is 32 bytes
+    const size_t tileBytes = size_t(tile) * tile / 8;
+    for (size_t t = 0; t < nTiles; ++t) {
+      const uint64_t e = index_[t];
+      if (e > kBlocked && (e % 8 != 0 || e + tileBytes > file_.size())) {
+        std::cerr << "Corrupt tile index in '" << path << "'\n";
+        close();
+        return false;
+      }
+    }
+    w = W; h = H;
+    tile_ = int(tile);
+    shift_ = 0;
+    while ((1 << shift_) < tile_) ++shift_;
+    tilesX_ = int(tx); tilesY_ = int(ty);
+    return true;
+  }
+
+  void close() {
+    file_.close();
+    index_ = nullptr;
+    w = h = 0;
+    tile_ = tilesX_ = tilesY_ = 0;
+  }
+
+  bool isOpen() const { return index_ != nullptr; }
+  int tileSize() const { return tile_; }
+  int tilesX() const { return tilesX_; }
+  int tilesY() const { return tilesY_; }
+
+  // Tiles stored as bits (the rest are uniformly free or blocked).
+  int storedTiles() const {
+    int n = 0;
+    for (size_t t = 0; t < size_t(tilesX_) * size_t(tilesY_); ++t) n += index_[t] > kBlocked;
+    return n;
+  }
+
+  // Stored tiles with at least one page resident in memory (-1 if the
+  // platform cannot tell).
+  long long residentTiles() const {
+    long long n = 0;
+    const size_t tileBytes = size_t(tile_) * size_t(tile_) / 8;
+    for (size_t t = 0; t < size_t(tilesX_) * size_t(tilesY_); ++t) {
+      if (index_[t] <= kBlocked) continue;
+      const long long r = file_.residentPages(size_t(index_[t]), tileBytes);
+      if (r < 0) return -1;
+      n += r > 0;
+    }
+    return n;
+  }
+
+  bool inBounds(int x, int y) const { return x >= 0 && y >= 0 && x < w && y < h; }
+
+  bool blocked(int x, int y) const {
+    const uint64_t e = index_[size_t(y >> shift_) * size_t(tilesX_) + size_t(x >> shift_)];
+    if (e <= kBlocked) return e == kBlocked;
+    const int lx = x & (tile_ - 1), ly = y & (tile_ - 1);
+    return (file_.data()[e + (size_t(ly) << (shift_ - 3)) + size_t(lx >> 3)] >> (lx & 7)) & 1u;
+  }
+
+  bool isFree(int x, int y) const { return inBounds(x, y) && !blocked(x, y); }
+
+  uint8_t freeMask(int x, int y) const {
+    const int dx[8] = {1,1,0,-1,-1,-1,0,1};
+    const int dy[8] = {0,1,1,1,0,-1,-1,-1};
+    uint8_t m = 0;
+    for (int k = 0; k < 8; ++k)
+      if (isFree(x + dx[k], y + dy[k])) m |= uint8_t(1u << k);
+    return m;
+  }
+
+  // Copy the window [x0, x0 + ww) x [y0, y0 + hh) (clipped to the map) into
+  // `out`, rows split across threads. Only the tiles it overlaps are read.
+  bool extract(GridMap& out, int x0 = 0, int y0 = 0, int ww = -1, int hh = -1, int threads = 0) const {
+    PP_PROF_SCOPE("tiles.extract");
+    if (!isOpen()) return false;
+    if (ww < 0) ww = w;
+    if (hh < 0) hh = h;
+    x0 = std::max(0, x0); y0 = std::max(0, y0);
+    ww = std::min(ww, w - x0); hh = std::min(hh, h - y0);
+    if (ww < 1 || hh < 1) return false;
+    out.w = ww; out.h = hh;
+    out.occ.assign(size_t(ww) * size_t(hh), 0);
+    out.replaced();
+    parallelRanges(hh, threads, [&](int r0, int r1) {
+      for (int r = r0; r < r1; ++r) {
+        const int y = y0 + r;
+        uint8_t* dst = &out.occ[size_t(r) * size_t(ww)];
+        for (int x = x0; x < x0 + ww;) {
+          const int tileEnd = std::min(x0 + ww, ((x >> shift_) + 1) << shift_);
+          const uint64_t e = index_[size_t(y >> shift_) * size_t(tilesX_) + size_t(x >> shift_)];
+          if (e <= kBlocked) {
+            std::memset(dst + (x - x0), int(e), size_t(tileEnd - x));
+          } else {
+            const uint8_t* row = file_.data() + e + (size_t(y & (tile_ - 1)) << (shift_ - 3));
+            for (int c = x; c < tileEnd;) {
+              const int lx = c & (tile_ - 1);
+              if ((lx & 7) == 0 && c + 8 <= tileEnd) { // a whole byte: 8 cells at once
+                std::memcpy(dst + (c - x0), kExpand[row[lx >> 3]], 8);
+                c += 8;
+              } else {
+                dst[c - x0] = (row[lx >> 3] >> (lx & 7)) & 1u;
+                ++c;
+              }
+            }
+          }
+          x = tileEnd;
+        }
+      }
+    });
+    return true;
+  }
+
+private:
+  MappedFile file_;
+  const uint64_t* index_ = nullptr;
+  int tile_ = 0, shift_ = 0, tilesX_ = 0, tilesY_ = 0;
+};
+
+} // namespace tiles